@@ -14,6 +14,9 @@
 /* PIT cycles per second. */
 #define PIT_HZ 1193180
 
+/* Nanoseconds per second. */
+#define NS_PER_SEC (1000 * 1000 * 1000)
+
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -81,3 +84,46 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Makes channel 0 raise interrupt line 0 once, NS nanoseconds
+   from now, using mode 0, "interrupt on terminal count".  This
+   replaces any periodic interrupt set up by
+   pit_configure_channel() and any earlier countdown.  The PIT
+   cannot count for less than 2 or more than 65535 of its cycles,
+   that is, from about 2 us up to about 55 ms, so NS is rounded up
+   to a whole number of cycles and brought within that range.
+   Returns the delay actually programmed, in nanoseconds. */
+int64_t
+pit_oneshot (int64_t ns)
+{
+  int64_t count;
+  enum intr_level old_level;
+
+  if (ns < 0)
+    ns = 0;
+  if (ns > NS_PER_SEC)
+    ns = NS_PER_SEC;
+  count = (ns * PIT_HZ + NS_PER_SEC - 1) / NS_PER_SEC;
+  if (count < 2)
+    count = 2;
+  else if (count > 0xffff)
+    count = 0xffff;
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, 0x30);
+  outb (PIT_PORT_COUNTER (0), count);
+  outb (PIT_PORT_COUNTER (0), count >> 8);
+  intr_set_level (old_level);
+
+  return count * NS_PER_SEC / PIT_HZ;
+}
+
+/* Stops channel 0 from raising interrupt line 0 until the next
+   pit_oneshot() or pit_configure_channel().  In mode 0, the
+   counter does not start until it is given a count, so selecting
+   the mode alone leaves it idle. */
+void
+pit_stop (void)
+{
+  outb (PIT_PORT_CONTROL, 0x30);
+}
@@ -4,5 +4,7 @@
 #include <stdint.h>
 
 void pit_configure_channel (int channel, int mode, int frequency);
+int64_t pit_oneshot (int64_t ns);
+void pit_stop (void);
 
 #endif /* devices/pit.h */
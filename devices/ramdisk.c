@@ -0,0 +1,188 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A block device backed by memory reserved at boot.
+
+   The disk's contents live in individually allocated kernel
+   pages rather than one contiguous run, so that a large ramdisk
+   does not depend on the kernel pool being unfragmented.  Each
+   page holds SECTORS_PER_PAGE consecutive sectors, and ranged
+   transfers are broken up at page boundaries only, so a whole
+   page moves with a single memcpy().
+
+   A ramdisk is volatile: it starts out zeroed and its contents
+   are lost at shutdown.  That makes it suitable for the scratch
+   and swap roles, whose contents never need to outlive a run. */
+
+/* Number of sectors in one page of ramdisk storage. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A ramdisk. */
+struct ramdisk
+  {
+    size_t page_cnt;            /* Number of pages of storage. */
+    uint8_t **pages;            /* Kernel virtual address of each page. */
+  };
+
+/* Number of ramdisks created so far, used to name them. */
+static int ramdisk_cnt;
+
+static struct block_operations ramdisk_operations;
+
+/* Creates and registers a ramdisk with room for SIZE bytes,
+   rounded up to a whole number of pages, in the given TYPE.
+   The memory is taken from the kernel pool.  Panics if it is
+   not available, since a ramdisk is only ever requested on the
+   kernel command line. */
+struct block *
+ramdisk_create (enum block_type type, size_t size)
+{
+  struct ramdisk *rd;
+  char name[16];
+  char extra_info[32];
+  size_t i;
+
+  ASSERT (size > 0);
+
+  rd = malloc (sizeof *rd);
+  if (rd == NULL)
+    PANIC ("Failed to allocate memory for ramdisk descriptor");
+  rd->page_cnt = DIV_ROUND_UP (size, PGSIZE);
+  rd->pages = malloc (rd->page_cnt * sizeof *rd->pages);
+  if (rd->pages == NULL)
+    PANIC ("Failed to allocate memory for ramdisk page index");
+
+  for (i = 0; i < rd->page_cnt; i++)
+    {
+      rd->pages[i] = palloc_get_page (PAL_ZERO);
+      if (rd->pages[i] == NULL)
+        PANIC ("Out of memory allocating %zu-page ramdisk "
+               "(got %zu pages)", rd->page_cnt, i);
+    }
+
+  snprintf (name, sizeof name, "ram%d", ramdisk_cnt++);
+  snprintf (extra_info, sizeof extra_info, "ramdisk, %zu pages",
+            rd->page_cnt);
+  return block_register (name, type, extra_info,
+                         rd->page_cnt * SECTORS_PER_PAGE,
+                         &ramdisk_operations, rd);
+}
+
+/* Parses a ramdisk size such as "4M", "512K", or "65536" (bytes)
+   in S and stores it in *SIZE.  Returns true if successful,
+   false if S is malformed, the size is zero, or it does not fit
+   in a size_t. */
+bool
+ramdisk_parse_size (const char *s, size_t *size)
+{
+  size_t value = 0;
+  size_t scale = 1;
+
+  if (*s < '0' || *s > '9')
+    return false;
+  for (; *s >= '0' && *s <= '9'; s++)
+    {
+      size_t digit = *s - '0';
+      if (value > (SIZE_MAX - digit) / 10)
+        return false;
+      value = value * 10 + digit;
+    }
+
+  if (*s == 'k' || *s == 'K')
+    {
+      scale = 1024;
+      s++;
+    }
+  else if (*s == 'm' || *s == 'M')
+    {
+      scale = 1024 * 1024;
+      s++;
+    }
+  if (value > SIZE_MAX / scale)
+    return false;
+
+  *size = value * scale;
+  return *s == '\0' && value > 0;
+}
+
+/* Returns the address of sector SECTOR within ramdisk RD. */
+static uint8_t *
+sector_addr (const struct ramdisk *rd, block_sector_t sector)
+{
+  ASSERT (sector / SECTORS_PER_PAGE < rd->page_cnt);
+  return (rd->pages[sector / SECTORS_PER_PAGE]
+          + sector % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE);
+}
+
+/* Copies CNT sectors starting at SECTOR between ramdisk RD and
+   BUFFER, in the direction given by WRITE.  Each iteration
+   moves as many sectors as remain in the current page. */
+static void
+transfer (struct ramdisk *rd, block_sector_t sector, block_sector_t cnt,
+          uint8_t *buffer, bool write)
+{
+  while (cnt > 0)
+    {
+      block_sector_t page_left = SECTORS_PER_PAGE - sector % SECTORS_PER_PAGE;
+      block_sector_t chunk = cnt < page_left ? cnt : page_left;
+      size_t bytes = chunk * BLOCK_SECTOR_SIZE;
+
+      if (write)
+        memcpy (sector_addr (rd, sector), buffer, bytes);
+      else
+        memcpy (buffer, sector_addr (rd, sector), bytes);
+
+      sector += chunk;
+      cnt -= chunk;
+      buffer += bytes;
+    }
+}
+
+/* Reads sector SECTOR from ramdisk RD_ into BUFFER. */
+static void
+ramdisk_read (void *rd_, block_sector_t sector, void *buffer)
+{
+  struct ramdisk *rd = rd_;
+  memcpy (buffer, sector_addr (rd, sector), BLOCK_SECTOR_SIZE);
+}
+
+/* Writes sector SECTOR to ramdisk RD_ from BUFFER. */
+static void
+ramdisk_write (void *rd_, block_sector_t sector, const void *buffer)
+{
+  struct ramdisk *rd = rd_;
+  memcpy (sector_addr (rd, sector), buffer, BLOCK_SECTOR_SIZE);
+}
+
+/* Reads CNT sectors starting at SECTOR from ramdisk RD_ into
+   BUFFER. */
+static void
+ramdisk_read_multiple (void *rd_, block_sector_t sector,
+                       block_sector_t cnt, void *buffer)
+{
+  transfer (rd_, sector, cnt, buffer, false);
+}
+
+/* Writes CNT sectors starting at SECTOR to ramdisk RD_ from
+   BUFFER. */
+static void
+ramdisk_write_multiple (void *rd_, block_sector_t sector,
+                        block_sector_t cnt, const void *buffer)
+{
+  transfer (rd_, sector, cnt, (uint8_t *) buffer, true);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    ramdisk_read,
+    ramdisk_write,
+    ramdisk_read_multiple,
+    ramdisk_write_multiple
+  };
@@ -0,0 +1,11 @@
+#ifndef DEVICES_RAMDISK_H
+#define DEVICES_RAMDISK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+
+struct block *ramdisk_create (enum block_type, size_t size);
+bool ramdisk_parse_size (const char *, size_t *size);
+
+#endif /* devices/ramdisk.h */
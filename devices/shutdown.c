@@ -5,9 +5,19 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
+#include "userprog/frame.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#endif
+#ifdef VM
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
@@ -127,6 +137,9 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  malloc_print_stats ();
+  palloc_print_stats ();
+  slab_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
 #endif
@@ -134,5 +147,12 @@ print_stats (void)
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
+  process_print_stats ();
+  syscall_print_stats ();
+  frame_print_stats ();
+  pagedir_print_stats ();
+#endif
+#ifdef VM
+  zswap_print_stats ();
 #endif
 }
@@ -1,9 +1,12 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stdio.h>
+#include <time-page.h>
 #include "devices/pit.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
@@ -17,9 +20,68 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+/* Nanoseconds per second and per timer tick. */
+#define NS_PER_SEC (1000 * 1000 * 1000)
+#define NS_PER_TICK (NS_PER_SEC / TIMER_FREQ)
+
+/* Timer ticks over which timer_calibrate() measures the TSC. */
+#define TSC_CALIBRATE_TICKS (TIMER_FREQ / 10)
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* TSC clocksource.
+
+   Until timer_calibrate() has measured the TSC against the PIT,
+   or for good if there is no TSC, the PIT interrupts once per
+   tick and time advances a tick at a time.  Once HIRES is set,
+   timer_ns() reads the TSC instead, and the PIT runs in one-shot
+   mode: each timer interrupt programs it to go off next at the
+   next tick or when the first sleeping thread is due, whichever
+   is sooner, so that sleeps of less than a tick can block. */
+static bool hires;
+static uint64_t clock_base_tsc;     /* TSC at CLOCK_BASE_NS. */
+static int64_t clock_base_ns;       /* timer_ns() at CLOCK_BASE_TSC. */
+static uint32_t clock_mult;         /* Nanoseconds per cycle, fixed point. */
+static int64_t next_tick_ns;        /* When tick TICKS + 1 is due. */
+static int64_t next_expiry_ns;      /* When the PIT will go off. */
+
+/* Tickless idle.
+
+   Ticks only matter while some thread is running, so when the
+   idle thread is about to halt the CPU, timer_idle_enter() sets
+   the PIT to go off only when the first sleeping thread is due,
+   or stops it altogether if none is asleep.  An idle CPU then
+   takes no interrupts it does not need, which matters most in a
+   virtual machine, where each one costs the host a VM exit.  The
+   next interrupt, whatever its source, ends tickless mode:
+   end_tickless() counts the ticks missed in the meantime, all of
+   them idle ticks, in one go.
+
+   Needs the TSC clocksource, to know how many ticks were missed.
+   Turned off by the kernel command-line option "-periodic". */
+bool timer_periodic;
+static bool tickless;               /* PIT stopped or slowed down? */
+
+/* Threads blocked in sleep_until(), soonest to wake first. */
+static struct list sleep_list;
+
+/* Statistics. */
+static unsigned long long sleeps;       /* Threads put to sleep. */
+static unsigned long long oneshots;     /* One-shot PIT programmings. */
+static unsigned long long idles;        /* Entries to tickless mode. */
+static int64_t skipped_ticks;           /* Ticks without an interrupt. */
+
+/* Page that user processes read the time from, or a null
+   pointer if none.  See timer_publish(). */
+static struct time_page *time_page;
+
+/* Whether the CPU has a time-stamp counter, and the TSC at tick
+   TSC_BASE_TICKS, from which the TSC rate is measured. */
+static bool have_tsc;
+static uint64_t tsc_base;
+static int64_t tsc_base_ticks;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
@@ -29,6 +91,11 @@ static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static void update_time_page (void);
+static void calibrate_tsc (void);
+static uint64_t tsc_to_ns (uint64_t cycles);
+static void program_timer (int64_t now);
+static void sleep_until (int64_t wakeup);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
@@ -37,9 +104,11 @@ timer_init (void)
 {
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+  list_init (&sleep_list);
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick, used to implement brief delays,
+   and, if the CPU has a TSC, switches to the TSC clocksource. */
 void
 timer_calibrate (void) 
 {
@@ -64,15 +133,96 @@ timer_calibrate (void)
       loops_per_tick |= test_bit;
 
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  if (cpu_features () & CPUID_TSC)
+    calibrate_tsc ();
 }
 
-/* Returns the number of timer ticks since the OS booted. */
+/* Measures the TSC rate against the PIT's periodic interrupt
+   over TSC_CALIBRATE_TICKS ticks, then, right on the last of
+   those ticks, switches timer_ns() over to the TSC and the PIT
+   to one-shot mode. */
+static void
+calibrate_tsc (void)
+{
+  enum intr_level old_level;
+  uint64_t start_tsc, end_tsc;
+  int64_t start;
+
+  /* Wait for a timer tick. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+
+  start_tsc = rdtsc ();
+  start = ticks;
+  while (ticks - start < TSC_CALIBRATE_TICKS)
+    barrier ();
+  end_tsc = rdtsc ();
+
+  old_level = intr_disable ();
+  clock_mult = (((uint64_t) TSC_CALIBRATE_TICKS * NS_PER_TICK
+                 << TIME_TSC_SHIFT) / (end_tsc - start_tsc));
+  clock_base_tsc = end_tsc;
+  clock_base_ns = ticks * NS_PER_TICK;
+  next_tick_ns = clock_base_ns + NS_PER_TICK;
+  hires = true;
+  program_timer (timer_ns ());
+  intr_set_level (old_level);
+
+  printf ("TSC clocksource: %'"PRIu64" cycles/s.\n",
+          (end_tsc - start_tsc) * TIMER_FREQ / TSC_CALIBRATE_TICKS);
+}
+
+/* Converts CYCLES of the TSC to nanoseconds. */
+static uint64_t
+tsc_to_ns (uint64_t cycles)
+{
+  /* Multiply the two halves separately, so that nothing
+     overflows 64 bits. */
+  return ((((cycles >> 32) * clock_mult) << (32 - TIME_TSC_SHIFT))
+          + (((cycles & 0xffffffff) * clock_mult) >> TIME_TSC_SHIFT));
+}
+
+/* Returns the number of nanoseconds since the OS booted.  Has
+   the resolution of the TSC once timer_calibrate() has switched
+   to it, and of a timer tick before then or without a TSC. */
 int64_t
-timer_ticks (void) 
+timer_ns (void)
+{
+  if (hires)
+    return clock_base_ns + tsc_to_ns (rdtsc () - clock_base_tsc);
+  return timer_ticks () * NS_PER_TICK;
+}
+
+/* Keeps PAGE up to date from now on, for user processes to read
+   the time from.  See lib/time-page.h. */
+void
+timer_publish (struct time_page *page)
 {
   enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
+
+  have_tsc = (cpu_features () & CPUID_TSC) != 0;
+  page->ns_per_tick = 1000 * 1000 * 1000 / TIMER_FREQ;
+  time_page = page;
+  update_time_page ();
   intr_set_level (old_level);
+}
+
+/* Returns the number of timer ticks since the OS booted. */
+int64_t
+timer_ticks (void) 
+{
+  int64_t t;
+
+  /* Only the timer interrupt changes TICKS, so if it reads the
+     same twice in a row, no tick split the 64-bit read. */
+  do
+    {
+      t = ticks;
+      barrier ();
+    }
+  while (t != ticks);
   return t;
 }
 
@@ -89,11 +239,85 @@ timer_elapsed (int64_t then)
 void
 timer_sleep (int64_t ticks) 
 {
-  int64_t start = timer_ticks ();
+  ASSERT (intr_get_level () == INTR_ON);
+
+  /* Tick N happens at N * NS_PER_TICK nanoseconds, with or
+     without the TSC clocksource. */
+  if (ticks > 0)
+    sleep_until ((timer_ticks () + ticks) * NS_PER_TICK);
+}
+
+/* Orders threads by the time they wake up. */
+static bool
+wakeup_less (const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+  return a->wakeup < b->wakeup;
+}
+
+/* Blocks the running thread until timer_ns() reaches WAKEUP.
+   Interrupts must be turned on. */
+static void
+sleep_until (int64_t wakeup)
+{
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
+
+  old_level = intr_disable ();
+  if (wakeup > timer_ns ())
+    {
+      t->wakeup = wakeup;
+      list_insert_ordered (&sleep_list, &t->elem, wakeup_less, NULL);
+      sleeps++;
+
+      /* Bring the next timer interrupt forward if we are the
+         first thread due. */
+      if (hires && wakeup < next_expiry_ns)
+        program_timer (timer_ns ());
+      thread_block ();
+    }
+  intr_set_level (old_level);
+}
+
+/* Wakes up every sleeping thread that is due by NOW. */
+static void
+wake_sleepers (int64_t now)
+{
+  while (!list_empty (&sleep_list))
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup > now)
+        break;
+      list_pop_front (&sleep_list);
+      thread_unblock (t);
+    }
+}
+
+/* Sets the PIT to go off at the next tick or when the first
+   sleeping thread is due, whichever is sooner.  NOW is the
+   current timer_ns().  Interrupts must be off. */
+static void
+program_timer (int64_t now)
+{
+  int64_t expiry = next_tick_ns;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!list_empty (&sleep_list))
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup < expiry)
+        expiry = t->wakeup;
+    }
+  pit_oneshot (expiry - now);
+  next_expiry_ns = expiry;
+  oneshots++;
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -164,16 +388,164 @@ void
 timer_print_stats (void) 
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  printf ("Timer: %llu sleeps, %llu one-shot interrupts programmed\n",
+          sleeps, oneshots);
+  printf ("Timer: %llu tickless idles, %"PRId64" ticks skipped\n",
+          idles, skipped_ticks);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  Enters tickless mode, if the TSC clocksource is
+   up and the kernel was not told to keep ticking. */
+void
+timer_idle_enter (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!hires || timer_periodic || tickless)
+    return;
+
+  tickless = true;
+  idles++;
+  if (list_empty (&sleep_list))
+    {
+      pit_stop ();
+      next_expiry_ns = INT64_MAX;
+    }
+  else
+    {
+      /* If the sleeper is further off than the PIT can count,
+         the PIT goes off early, and the timer interrupt brings us
+         out of tickless mode for a moment. */
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      next_expiry_ns = t->wakeup;
+      pit_oneshot (t->wakeup - timer_ns ());
+      oneshots++;
+    }
+}
+
+/* Counts the ticks that came due, as of NOW, while the PIT was
+   stopped or slowed down, and leaves tickless mode.  Only the
+   idle thread ran in that time, so they are all idle ticks.
+   Interrupts must be off. */
+static void
+end_tickless (int64_t now)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (tickless);
+
+  tickless = false;
+  if (now >= next_tick_ns)
+    {
+      int64_t missed = (now - next_tick_ns) / NS_PER_TICK + 1;
+
+      ticks += missed;
+      next_tick_ns += missed * NS_PER_TICK;
+      skipped_ticks += missed;
+      thread_idle_ticks (missed);
+      if (time_page != NULL)
+        update_time_page ();
+    }
+}
+
+/* Called by the idle thread just after the CPU was woken from a
+   halt, that is, after an interrupt.  If that was not the timer
+   interrupt, leaves tickless mode, catching up on the ticks and
+   wakeups that were missed, and restarts the regular tick. */
+void
+timer_idle_exit (void)
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (tickless)
+    {
+      int64_t now = timer_ns ();
+
+      end_tickless (now);
+      wake_sleepers (now);
+      program_timer (now);
+    }
+  intr_set_level (old_level);
 }
 
-/* Timer interrupt handler. */
+/* Counts a timer tick. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+tick (void)
 {
   ticks++;
+  if (time_page != NULL)
+    update_time_page ();
   thread_tick ();
 }
 
+/* Timer interrupt handler. */
+static void
+timer_interrupt (struct intr_frame *args UNUSED)
+{
+  int64_t now;
+
+  if (!hires)
+    {
+      tick ();
+      wake_sleepers (ticks * NS_PER_TICK);
+      return;
+    }
+
+  /* The interrupt may be for a sleeper rather than a tick, and
+     may come late, so count however many ticks are due. */
+  now = timer_ns ();
+  if (tickless)
+    end_tickless (now);
+  while (now >= next_tick_ns)
+    {
+      tick ();
+      next_tick_ns += NS_PER_TICK;
+    }
+  wake_sleepers (now);
+  program_timer (now);
+}
+
+/* Brings the time page up to date with the tick that just
+   happened.  Once a second, also measures the TSC rate over all
+   the ticks since the first update.  Interrupts must be off. */
+static void
+update_time_page (void)
+{
+  struct time_page *tp = time_page;
+  uint64_t tsc = have_tsc ? rdtsc () : 0;
+  uint32_t tsc_mult = tp->tsc_mult;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (hires)
+    tsc_mult = clock_mult;
+  else if (have_tsc)
+    {
+      if (tsc_base_ticks == 0)
+        {
+          tsc_base = tsc;
+          tsc_base_ticks = ticks;
+        }
+      else if ((ticks - tsc_base_ticks) % TIMER_FREQ == 0)
+        {
+          uint64_t cycles_per_tick = ((tsc - tsc_base)
+                                      / (ticks - tsc_base_ticks));
+          if (cycles_per_tick != 0)
+            tsc_mult = (((uint64_t) tp->ns_per_tick << TIME_TSC_SHIFT)
+                        / cycles_per_tick);
+        }
+    }
+
+  tp->seq++;
+  barrier ();
+  tp->ticks = ticks;
+  tp->tick_tsc = tsc;
+  tp->tsc_mult = tsc_mult;
+  barrier ();
+  tp->seq++;
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
@@ -220,7 +592,15 @@ real_time_sleep (int64_t num, int32_t denom)
   int64_t ticks = num * TIMER_FREQ / denom;
 
   ASSERT (intr_get_level () == INTR_ON);
-  if (ticks > 0)
+  if (hires)
+    {
+      /* The PIT can wake us at any moment, not just on a tick, so
+         block for just as long as asked, however short. */
+      ASSERT (NS_PER_SEC % denom == 0);
+      if (num > 0)
+        sleep_until (timer_ns () + num * (NS_PER_SEC / denom));
+    }
+  else if (ticks > 0)
     {
       /* We're waiting for at least one full timer tick.  Use
          timer_sleep() because it will yield the CPU to other
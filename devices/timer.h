@@ -2,16 +2,26 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Keep the timer interrupting every tick while idle? */
+extern bool timer_periodic;
+
+struct time_page;
+
 void timer_init (void);
 void timer_calibrate (void);
+void timer_publish (struct time_page *);
+void timer_idle_enter (void);
+void timer_idle_exit (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+int64_t timer_ns (void);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
@@ -0,0 +1,19 @@
+#ifndef EXAMPLES_BENCH_H
+#define EXAMPLES_BENCH_H
+
+#include <stdint.h>
+
+/* Helpers shared by the benchmark programs in this directory. */
+
+/* Returns the processor's time-stamp counter.  RDTSC may be
+   executed in user mode, so reading it costs no system call and
+   does not disturb what is being measured. */
+static inline uint64_t
+bench_cycles (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+#endif /* examples/bench.h */
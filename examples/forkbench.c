@@ -0,0 +1,69 @@
+/* forkbench.c
+
+   Measures the cost of fork() as the parent's resident memory
+   grows.  With copy-on-write, fork only copies page tables, so
+   its cost should stay nearly flat; the price is instead paid a
+   page at a time by the first write to each shared page, which
+   is measured separately. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "bench.h"
+
+/* Forks timed per footprint. */
+#define ROUNDS 16
+
+/* Largest footprint tried, in pages. */
+#define MAX_PAGES 1024
+
+#define PAGE_SIZE 4096
+
+int
+main (void)
+{
+  char *heap = sbrk (MAX_PAGES * PAGE_SIZE);
+  int pages, i;
+
+  if (heap == (char *) -1)
+    {
+      printf ("sbrk failed\n");
+      return EXIT_FAILURE;
+    }
+
+  printf ("%8s %16s %16s\n", "pages", "fork cycles", "first write");
+  for (pages = 16; pages <= MAX_PAGES; pages *= 4)
+    {
+      uint64_t fork_cycles = 0, write_cycles = 0;
+      int round;
+
+      /* Make the first PAGES pages of the heap resident. */
+      for (i = 0; i < pages; i++)
+        heap[i * PAGE_SIZE] = i;
+
+      for (round = 0; round < ROUNDS; round++)
+        {
+          uint64_t start = bench_cycles ();
+          pid_t pid = fork ();
+
+          if (pid == 0)
+            exit (0);
+          fork_cycles += bench_cycles () - start;
+          if (pid == PID_ERROR)
+            {
+              printf ("fork failed\n");
+              return EXIT_FAILURE;
+            }
+
+          /* The child may not have exited yet, in which case this
+             write copies the page. */
+          start = bench_cycles ();
+          heap[round * PAGE_SIZE]++;
+          write_cycles += bench_cycles () - start;
+          wait (pid);
+        }
+
+      printf ("%8d %16llu %16llu\n", pages,
+              fork_cycles / ROUNDS, write_cycles / ROUNDS);
+    }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+/* fsbench.c
+
+   Times creating, writing, reading, and removing a small file,
+   first on the disk file system and then on the in-memory file
+   system mounted at /tmp, and prints the average cost of each
+   step in processor cycles. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "bench.h"
+
+/* Number of create/write/read/remove rounds per file system. */
+#define ROUNDS 32
+
+/* Size of the file written and read in each round. */
+#define FILE_SIZE 4096
+
+static char buf[FILE_SIZE];
+
+/* Cycles spent in each step, summed over all rounds. */
+struct fs_cycles
+  {
+    uint64_t create;
+    uint64_t write;
+    uint64_t read;
+    uint64_t remove;
+  };
+
+/* Runs ROUNDS rounds against the file named NAME, accumulating
+   their costs into C.  Returns false if any step fails. */
+static bool
+run (const char *name, struct fs_cycles *c)
+{
+  int i;
+
+  for (i = 0; i < ROUNDS; i++)
+    {
+      uint64_t start;
+      int fd;
+
+      start = bench_cycles ();
+      if (!create (name, FILE_SIZE))
+        {
+          printf ("%s: create failed\n", name);
+          return false;
+        }
+      c->create += bench_cycles () - start;
+
+      start = bench_cycles ();
+      fd = open (name);
+      if (fd < 0 || write (fd, buf, FILE_SIZE) != FILE_SIZE)
+        {
+          printf ("%s: write failed\n", name);
+          return false;
+        }
+      c->write += bench_cycles () - start;
+
+      start = bench_cycles ();
+      seek (fd, 0);
+      if (read (fd, buf, FILE_SIZE) != FILE_SIZE)
+        {
+          printf ("%s: read failed\n", name);
+          return false;
+        }
+      c->read += bench_cycles () - start;
+
+      start = bench_cycles ();
+      close (fd);
+      if (!remove (name))
+        {
+          printf ("%s: remove failed\n", name);
+          return false;
+        }
+      c->remove += bench_cycles () - start;
+    }
+  return true;
+}
+
+/* Prints the per-round averages in C, labelled LABEL. */
+static void
+report (const char *label, const struct fs_cycles *c)
+{
+  printf ("%-6s create %10llu  write %10llu  read %10llu  remove %10llu\n",
+          label, c->create / ROUNDS, c->write / ROUNDS, c->read / ROUNDS,
+          c->remove / ROUNDS);
+}
+
+int
+main (void)
+{
+  struct fs_cycles disk = {0, 0, 0, 0}, tmp = {0, 0, 0, 0};
+  int i;
+
+  for (i = 0; i < FILE_SIZE; i++)
+    buf[i] = i;
+
+  if (!run ("fsbench", &disk) || !run ("/tmp/fsbench", &tmp))
+    return EXIT_FAILURE;
+
+  printf ("Average cycles per step over %d rounds of %d bytes:\n",
+          ROUNDS, FILE_SIZE);
+  report ("disk", &disk);
+  report ("tmpfs", &tmp);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+/* mallocbench.c
+
+   Measures the throughput of the user-space allocator.  Each
+   round allocates a batch of blocks of mixed sizes, touches
+   them, and frees them again in a scrambled order, and the
+   program prints the average cost of an allocation and of a
+   free in processor cycles. */
+
+#include <malloc.h>
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "bench.h"
+
+/* Number of rounds. */
+#define ROUNDS 64
+
+/* Blocks allocated, and then freed, per round. */
+#define BATCH 512
+
+/* Largest block size requested.  Most requests are small, as in
+   typical programs, with an occasional large one. */
+#define MAX_SIZE 4096
+
+static void *blocks[BATCH];
+static size_t sizes[BATCH];
+
+int
+main (void)
+{
+  uint64_t alloc_cycles = 0, free_cycles = 0;
+  int round, i;
+
+  random_init (0);
+  for (i = 0; i < BATCH; i++)
+    sizes[i] = (i % 16 == 0
+                ? random_ulong () % MAX_SIZE + 1
+                : random_ulong () % 128 + 1);
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      uint64_t start;
+
+      start = bench_cycles ();
+      for (i = 0; i < BATCH; i++)
+        {
+          blocks[i] = malloc (sizes[i]);
+          if (blocks[i] == NULL)
+            {
+              printf ("malloc(%zu) failed\n", sizes[i]);
+              return EXIT_FAILURE;
+            }
+        }
+      alloc_cycles += bench_cycles () - start;
+
+      for (i = 0; i < BATCH; i++)
+        *(char *) blocks[i] = i;
+
+      /* Free in a different order each round, so that free lists
+         do not simply mirror the order of allocation. */
+      start = bench_cycles ();
+      for (i = 0; i < BATCH; i++)
+        free (blocks[(i * 7 + round) % BATCH]);
+      free_cycles += bench_cycles () - start;
+    }
+
+  printf ("%d rounds of %d blocks: malloc %llu cycles, free %llu cycles "
+          "on average\n", ROUNDS, BATCH,
+          alloc_cycles / (ROUNDS * BATCH), free_cycles / (ROUNDS * BATCH));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+/* membench.c
+
+   Measures the bandwidth of memcpy, memmove, and memset at a
+   range of block sizes, with source and destination both
+   word-aligned and deliberately misaligned, and prints the
+   result in bytes copied per 100 processor cycles. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "bench.h"
+
+/* Largest block size measured. */
+#define MAX_SIZE 16384
+
+/* Bytes moved per size and alignment; small blocks are repeated
+   more times so that every measurement covers the same amount
+   of data. */
+#define TOTAL_BYTES (256 * 1024)
+
+static char src_buf[MAX_SIZE + 16];
+static char dst_buf[MAX_SIZE + 16];
+
+static const size_t sizes[] = {8, 64, 256, 1024, 4096, MAX_SIZE};
+
+/* Source and destination offsets from a word boundary. */
+static const struct
+  {
+    int src, dst;
+  }
+alignments[] = {{0, 0}, {1, 1}, {1, 3}};
+
+enum op { OP_MEMCPY, OP_MEMMOVE, OP_MEMSET };
+
+/* Performs OP on SIZE-byte blocks at SRC and DST until
+   TOTAL_BYTES have been moved and returns the cycles taken. */
+static uint64_t
+measure (enum op op, char *dst, const char *src, size_t size)
+{
+  size_t reps = TOTAL_BYTES / size;
+  uint64_t start = bench_cycles ();
+  size_t i;
+
+  for (i = 0; i < reps; i++)
+    switch (op)
+      {
+      case OP_MEMCPY:
+        memcpy (dst, src, size);
+        break;
+      case OP_MEMMOVE:
+        memmove (dst, src, size);
+        break;
+      case OP_MEMSET:
+        memset (dst, i, size);
+        break;
+      }
+  return bench_cycles () - start;
+}
+
+int
+main (void)
+{
+  static const char *names[] = {"memcpy", "memmove", "memset"};
+  enum op op;
+  size_t s, a;
+
+  memset (src_buf, 0x5a, sizeof src_buf);
+
+  printf ("Bytes per 100 cycles (src+dst offset):\n");
+  printf ("%-8s %6s", "", "size");
+  for (a = 0; a < sizeof alignments / sizeof *alignments; a++)
+    printf ("     +%d/+%d", alignments[a].src, alignments[a].dst);
+  printf ("\n");
+
+  for (op = OP_MEMCPY; op <= OP_MEMSET; op++)
+    for (s = 0; s < sizeof sizes / sizeof *sizes; s++)
+      {
+        printf ("%-8s %6zu", names[op], sizes[s]);
+        for (a = 0; a < sizeof alignments / sizeof *alignments; a++)
+          {
+            uint64_t cycles = measure (op, dst_buf + alignments[a].dst,
+                                       src_buf + alignments[a].src,
+                                       sizes[s]);
+            uint64_t bytes = TOTAL_BYTES / sizes[s] * sizes[s];
+            printf (" %10llu", cycles > 0 ? bytes * 100 / cycles : 0);
+          }
+        printf ("\n");
+      }
+  return EXIT_SUCCESS;
+}
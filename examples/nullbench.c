@@ -0,0 +1,85 @@
+/* nullbench.c
+
+   Measures the round trip into the kernel and back for the two
+   ways in: "int $0x30" and SYSENTER.  Calls getpid(), which does
+   no work in the kernel, through each path in turn, so the time
+   per call is almost all entry and exit.  getpid() in the C
+   library picks the path itself, so we issue the instructions
+   directly here instead.  For comparison, also times clock_ns(),
+   which reads the time without entering the kernel at all. */
+
+#include <clock.h>
+#include <stdio.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "bench.h"
+
+/* Calls timed per path. */
+#define ROUNDS 100000
+
+/* Calls getpid() through "int $0x30". */
+static inline pid_t
+getpid_int (void)
+{
+  pid_t pid;
+  asm volatile ("pushl %[number]; int $0x30; addl $4, %%esp"
+                : "=a" (pid)
+                : [number] "i" (SYS_GETPID)
+                : "memory");
+  return pid;
+}
+
+/* Calls getpid() through SYSENTER. */
+static inline pid_t
+getpid_sysenter (void)
+{
+  pid_t pid;
+  asm volatile ("movl %%esp, %%ecx; leal 1f, %%edx; sysenter; 1:"
+                : "=a" (pid)
+                : "0" (SYS_GETPID)
+                : "ecx", "edx", "memory", "cc");
+  return pid;
+}
+
+/* Returns true if the CPU has SYSENTER and SYSEXIT. */
+static bool
+have_sysenter (void)
+{
+  uint32_t eax = 1, ebx, ecx = 0, edx;
+  asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+  return (edx & (1 << 11)) != 0;
+}
+
+int
+main (void)
+{
+  uint64_t start;
+  pid_t pid = getpid ();
+  int i;
+
+  start = bench_cycles ();
+  for (i = 0; i < ROUNDS; i++)
+    if (getpid_int () != pid)
+      return EXIT_FAILURE;
+  printf ("%-24s %10llu cycles\n", "int $0x30:",
+          (bench_cycles () - start) / ROUNDS);
+
+  start = bench_cycles ();
+  for (i = 0; i < ROUNDS; i++)
+    clock_ns ();
+  printf ("%-24s %10llu cycles\n", "clock_ns():",
+          (bench_cycles () - start) / ROUNDS);
+
+  if (!have_sysenter ())
+    {
+      printf ("%-24s %10s\n", "sysenter:", "unsupported");
+      return EXIT_SUCCESS;
+    }
+  start = bench_cycles ();
+  for (i = 0; i < ROUNDS; i++)
+    if (getpid_sysenter () != pid)
+      return EXIT_FAILURE;
+  printf ("%-24s %10llu cycles\n", "sysenter:",
+          (bench_cycles () - start) / ROUNDS);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+/* ringbench.c
+
+   Compares many small reads and writes made one system call at a
+   time with the same requests made through a system call ring.
+   Writes a file in CHUNK-byte pieces and reads it back, first
+   with plain write() and read(), then queueing the pieces on a
+   ring and submitting BATCH of them per ring_enter() call, and
+   prints the average cycles per request of each. */
+
+#include <stdio.h>
+#include <ring.h>
+#include <syscall.h>
+#include "bench.h"
+
+/* File written and read back. */
+#define FILE_NAME "ringbench.tmp"
+#define FILE_SIZE 8192
+
+/* Bytes per request. */
+#define CHUNK 64
+
+/* Requests per ring_enter() call.  No more than RING_ENTRIES. */
+#define BATCH 32
+
+#define CHUNK_CNT (FILE_SIZE / CHUNK)
+
+static char buf[FILE_SIZE];
+static struct syscall_ring ring;
+
+/* Writes or reads the file open as FD a chunk at a time with
+   plain system calls, and returns the cycles taken. */
+static uint64_t
+run_plain (int fd, bool writing)
+{
+  uint64_t start = bench_cycles ();
+  int i;
+
+  seek (fd, 0);
+  for (i = 0; i < CHUNK_CNT; i++)
+    {
+      int n = (writing
+               ? write (fd, buf + i * CHUNK, CHUNK)
+               : read (fd, buf + i * CHUNK, CHUNK));
+      if (n != CHUNK)
+        return 0;
+    }
+  return bench_cycles () - start;
+}
+
+/* Writes or reads the file open as FD a chunk at a time through
+   the ring, and returns the cycles taken. */
+static uint64_t
+run_ring (int fd, bool writing)
+{
+  uint64_t start = bench_cycles ();
+  struct ring_result r;
+  int i;
+
+  ring_seek (&ring, fd, 0, CHUNK_CNT);
+  for (i = 0; i < CHUNK_CNT; i++)
+    {
+      if (writing)
+        ring_write (&ring, fd, buf + i * CHUNK, CHUNK, i);
+      else
+        ring_read (&ring, fd, buf + i * CHUNK, CHUNK, i);
+      if (ring_pending (&ring) == BATCH || i == CHUNK_CNT - 1)
+        {
+          ring_submit (&ring);
+          while (ring_reap (&ring, &r))
+            if (r.tag != CHUNK_CNT && r.result != CHUNK)
+              return 0;
+        }
+    }
+  return bench_cycles () - start;
+}
+
+int
+main (void)
+{
+  uint64_t cycles[4];
+  int fd;
+
+  ring_init (&ring);
+  if (!create (FILE_NAME, FILE_SIZE) || (fd = open (FILE_NAME)) < 0)
+    {
+      printf ("%s: create failed\n", FILE_NAME);
+      return EXIT_FAILURE;
+    }
+
+  cycles[0] = run_plain (fd, true);
+  cycles[1] = run_plain (fd, false);
+  cycles[2] = run_ring (fd, true);
+  cycles[3] = run_ring (fd, false);
+  close (fd);
+  remove (FILE_NAME);
+  if (cycles[0] == 0 || cycles[1] == 0 || cycles[2] == 0 || cycles[3] == 0)
+    {
+      printf ("%s: short read or write\n", FILE_NAME);
+      return EXIT_FAILURE;
+    }
+
+  printf ("%d requests of %d bytes, %d per ring_enter()\n",
+          CHUNK_CNT, CHUNK, BATCH);
+  printf ("%-24s %10llu cycles\n", "write:", cycles[0] / CHUNK_CNT);
+  printf ("%-24s %10llu cycles\n", "read:", cycles[1] / CHUNK_CNT);
+  printf ("%-24s %10llu cycles\n", "ring write:", cycles[2] / CHUNK_CNT);
+  printf ("%-24s %10llu cycles\n", "ring read:", cycles[3] / CHUNK_CNT);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+/* scanbench.c
+
+   Measures what the evictor's accessed-bit scanning costs the
+   process being scanned.  Sweeps over working sets of growing
+   size, touching every page once per pass.  While the working set
+   fits in memory nothing is evicted and a touch costs a TLB hit or
+   miss; once it no longer fits (run with a small -ul), every pass
+   makes the evictor clear accessed bits across the working set
+   before it finds a victim.  Each cleared bit used to flush the
+   whole TLB; now the TLB entries are invalidated once per scan, so
+   the cycles per touch for resident pages should stay close to
+   those of the smaller working sets.  The kernel prints how many
+   pages it scanned and how many bits it cleared at shutdown. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "bench.h"
+
+/* Passes timed per working set. */
+#define PASSES 8
+
+/* Largest working set tried, in pages. */
+#define MAX_PAGES 2048
+
+#define PAGE_SIZE 4096
+
+int
+main (void)
+{
+  char *heap = sbrk (MAX_PAGES * PAGE_SIZE);
+  int pages, i;
+
+  if (heap == (char *) -1)
+    {
+      printf ("sbrk failed\n");
+      return EXIT_FAILURE;
+    }
+
+  printf ("%8s %16s\n", "pages", "cycles/touch");
+  for (pages = 64; pages <= MAX_PAGES; pages *= 2)
+    {
+      uint64_t start;
+      int pass;
+
+      /* Make the working set resident, as far as it fits. */
+      for (i = 0; i < pages; i++)
+        heap[i * PAGE_SIZE] = i;
+
+      start = bench_cycles ();
+      for (pass = 0; pass < PASSES; pass++)
+        for (i = 0; i < pages; i++)
+          heap[i * PAGE_SIZE]++;
+      printf ("%8d %16llu\n", pages,
+              (bench_cycles () - start) / ((uint64_t) PASSES * pages));
+    }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+/* switchbench.c
+
+   Measures the cost of switching between two user processes.
+   First times yield() with no other process ready, which is a
+   system call that returns to the same process, then forks and
+   has parent and child yield to each other, so that every yield
+   switches address spaces.  The difference is the cost of the
+   switch itself, including the CR3 reload and the TLB refills it
+   causes. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "bench.h"
+
+/* Yields timed per measurement. */
+#define ROUNDS 10000
+
+int
+main (void)
+{
+  uint64_t start, alone, paired;
+  pid_t pid;
+  int i;
+
+  start = bench_cycles ();
+  for (i = 0; i < ROUNDS; i++)
+    yield ();
+  alone = (bench_cycles () - start) / ROUNDS;
+
+  pid = fork ();
+  if (pid == PID_ERROR)
+    {
+      printf ("fork failed\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Each of our yields runs the child until it yields back, so a
+     round trip is two switches. */
+  start = bench_cycles ();
+  for (i = 0; i < ROUNDS; i++)
+    yield ();
+  paired = (bench_cycles () - start) / ROUNDS;
+  if (pid == 0)
+    exit (0);
+  wait (pid);
+
+  printf ("%-24s %10llu cycles\n", "yield, no switch:", alone);
+  printf ("%-24s %10llu cycles\n", "yield, switch:",
+          paired > 2 * alone ? (paired - 2 * alone) / 2 : 0);
+  return EXIT_SUCCESS;
+}
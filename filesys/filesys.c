@@ -6,6 +6,7 @@
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/tmpfs.h"
 
 /* Partition that contains the file system. */
 struct block *fs_device;
@@ -22,6 +23,9 @@ filesys_init (bool format)
     PANIC ("No file system device found, can't initialize file system.");
 
   inode_init ();
+  file_init ();
+  dir_init ();
+  tmpfs_init ();
   free_map_init ();
 
   if (format) 
@@ -41,16 +45,24 @@ filesys_done (void)
 /* Creates a file named NAME with the given INITIAL_SIZE.
    Returns true if successful, false otherwise.
    Fails if a file named NAME already exists,
-   or if internal memory allocation fails. */
+   or if internal memory allocation fails.
+   Names under TMPFS_MOUNT are created in memory. */
 bool
 filesys_create (const char *name, off_t initial_size) 
 {
   block_sector_t inode_sector = 0;
-  struct dir *dir = dir_open_root ();
-  bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
-                  && dir_add (dir, name, inode_sector));
+  const char *tmp_name;
+  struct dir *dir;
+  bool success;
+
+  if (tmpfs_path (name, &tmp_name))
+    return tmpfs_create (tmp_name, initial_size);
+
+  dir = dir_open_root ();
+  success = (dir != NULL
+             && free_map_allocate (1, &inode_sector)
+             && inode_create (inode_sector, initial_size)
+             && dir_add (dir, name, inode_sector));
   if (!success && inode_sector != 0) 
     free_map_release (inode_sector, 1);
   dir_close (dir);
@@ -66,9 +78,14 @@ filesys_create (const char *name, off_t initial_size)
 struct file *
 filesys_open (const char *name)
 {
-  struct dir *dir = dir_open_root ();
+  const char *tmp_name;
+  struct dir *dir;
   struct inode *inode = NULL;
 
+  if (tmpfs_path (name, &tmp_name))
+    return file_open (tmpfs_open (tmp_name));
+
+  dir = dir_open_root ();
   if (dir != NULL)
     dir_lookup (dir, name, &inode);
   dir_close (dir);
@@ -83,8 +100,15 @@ filesys_open (const char *name)
 bool
 filesys_remove (const char *name) 
 {
-  struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
+  const char *tmp_name;
+  struct dir *dir;
+  bool success;
+
+  if (tmpfs_path (name, &tmp_name))
+    return tmpfs_remove (tmp_name);
+
+  dir = dir_open_root ();
+  success = dir != NULL && dir_remove (dir, name);
   dir_close (dir); 
 
   return success;
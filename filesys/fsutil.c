@@ -1,9 +1,11 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ustar.h>
+#include "devices/timer.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
@@ -11,6 +13,10 @@
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 
+/* Largest buffer, in pages, used to stream file data out of the
+   ustar archive during extraction. */
+#define EXTRACT_PAGES 16
+
 /* List files in the root directory. */
 void
 fsutil_ls (char **argv UNUSED) 
@@ -76,12 +82,28 @@ fsutil_extract (char **argv UNUSED)
 
   struct block *src;
   void *header, *data;
+  size_t data_pages;
+  block_sector_t data_sectors;
+  unsigned long long total_bytes = 0;
+  int file_cnt = 0;
+  int64_t start, elapsed;
 
-  /* Allocate buffers. */
+  /* Allocate buffers.  File data is streamed through a buffer of
+     up to EXTRACT_PAGES pages so that each device request and
+     each file write covers a long run of sectors.  Settle for a
+     smaller buffer if memory is tight. */
   header = malloc (BLOCK_SECTOR_SIZE);
-  data = malloc (BLOCK_SECTOR_SIZE);
-  if (header == NULL || data == NULL)
+  if (header == NULL)
+    PANIC ("couldn't allocate buffers");
+  for (data_pages = EXTRACT_PAGES; data_pages > 0; data_pages /= 2)
+    {
+      data = palloc_get_multiple (0, data_pages);
+      if (data != NULL)
+        break;
+    }
+  if (data_pages == 0)
     PANIC ("couldn't allocate buffers");
+  data_sectors = data_pages * PGSIZE / BLOCK_SECTOR_SIZE;
 
   /* Open source block device. */
   src = block_get_role (BLOCK_SCRATCH);
@@ -91,6 +113,7 @@ fsutil_extract (char **argv UNUSED)
   printf ("Extracting ustar archive from scratch device "
           "into file system...\n");
 
+  start = timer_ticks ();
   for (;;)
     {
       const char *file_name;
@@ -117,20 +140,30 @@ fsutil_extract (char **argv UNUSED)
 
           printf ("Putting '%s' into the file system...\n", file_name);
 
-          /* Create destination file. */
+          /* Create destination file.  Its full size is allocated
+             up front as one contiguous extent, so every chunk below
+             lands on disk as a single run too. */
           if (!filesys_create (file_name, size))
             PANIC ("%s: create failed", file_name);
           dst = filesys_open (file_name);
           if (dst == NULL)
             PANIC ("%s: open failed", file_name);
+          file_cnt++;
+          total_bytes += size;
 
-          /* Do copy. */
+          /* Do copy, a buffer's worth of sectors at a time.  The
+             archive pads file data out to a whole sector, so the
+             final partial sector can be read in full. */
           while (size > 0)
             {
-              int chunk_size = (size > BLOCK_SECTOR_SIZE
-                                ? BLOCK_SECTOR_SIZE
+              size_t buffer_size = data_sectors * BLOCK_SECTOR_SIZE;
+              int chunk_size = ((size_t) size > buffer_size
+                                ? (int) buffer_size
                                 : size);
-              block_read (src, sector++, data);
+              block_sector_t chunk_sectors = DIV_ROUND_UP (chunk_size,
+                                                           BLOCK_SECTOR_SIZE);
+              block_read_multiple (src, sector, chunk_sectors, data);
+              sector += chunk_sectors;
               if (file_write (dst, data, chunk_size) != chunk_size)
                 PANIC ("%s: write failed with %d bytes unwritten",
                        file_name, size);
@@ -141,6 +174,13 @@ fsutil_extract (char **argv UNUSED)
           file_close (dst);
         }
     }
+  elapsed = timer_elapsed (start);
+
+  printf ("Extracted %d files, %llu bytes in %lld ms",
+          file_cnt, total_bytes, elapsed * 1000 / TIMER_FREQ);
+  if (elapsed > 0)
+    printf (" (%llu kB/s)", total_bytes * TIMER_FREQ / elapsed / 1024);
+  printf (".\n");
 
   /* Erase the ustar header from the start of the block device,
      so that the extraction operation is idempotent.  We erase
@@ -151,7 +191,7 @@ fsutil_extract (char **argv UNUSED)
   block_write (src, 0, header);
   block_write (src, 1, header);
 
-  free (data);
+  palloc_free_multiple (data, data_pages);
   free (header);
 }
 
@@ -5,11 +5,18 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/tmpfs.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Sectors that fit in the page-sized bounce buffer. */
+#define BOUNCE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
 /* On-disk inode.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
 struct inode_disk
@@ -36,6 +43,7 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    struct tmpfs_file *tmpfs;           /* In-memory file, or null if on disk. */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -57,11 +65,15 @@ byte_to_sector (const struct inode *inode, off_t pos)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Cache that every `struct inode' is allocated from. */
+static struct slab_cache *inode_cache;
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  inode_cache = slab_cache_create ("inode", sizeof (struct inode), NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -119,7 +131,7 @@ inode_open (block_sector_t sector)
        e = list_next (e)) 
     {
       inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
+      if (inode->tmpfs == NULL && inode->sector == sector) 
         {
           inode_reopen (inode);
           return inode; 
@@ -127,7 +139,7 @@ inode_open (block_sector_t sector)
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = slab_alloc (inode_cache);
   if (inode == NULL)
     return NULL;
 
@@ -137,10 +149,40 @@ inode_open (block_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
+  inode->tmpfs = NULL;
   block_read (fs_device, inode->sector, &inode->data);
   return inode;
 }
 
+/* Returns a `struct inode' for the in-memory file TF, reusing
+   the existing one if TF is already open.  Reads and writes on
+   the returned inode are passed on to tmpfs.c.
+   Returns a null pointer if memory allocation fails. */
+struct inode *
+inode_open_tmpfs (struct tmpfs_file *tf)
+{
+  struct list_elem *e;
+  struct inode *inode;
+
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e)) 
+    {
+      inode = list_entry (e, struct inode, elem);
+      if (inode->tmpfs == tf) 
+        return inode_reopen (inode);
+    }
+
+  inode = slab_alloc (inode_cache);
+  if (inode == NULL)
+    return NULL;
+  memset (inode, 0, sizeof *inode);
+
+  list_push_front (&open_inodes, &inode->elem);
+  inode->open_cnt = 1;
+  inode->tmpfs = tf;
+  return inode;
+}
+
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode)
@@ -174,14 +216,19 @@ inode_close (struct inode *inode)
       list_remove (&inode->elem);
  
       /* Deallocate blocks if removed. */
-      if (inode->removed) 
+      if (inode->tmpfs != NULL)
+        {
+          if (inode->removed)
+            tmpfs_destroy (inode->tmpfs);
+        }
+      else if (inode->removed) 
         {
           free_map_release (inode->sector, 1);
           free_map_release (inode->data.start,
                             bytes_to_sectors (inode->data.length)); 
         }
 
-      free (inode); 
+      slab_free (inode_cache, inode);
     }
 }
 
@@ -204,6 +251,9 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
 
+  if (inode->tmpfs != NULL)
+    return tmpfs_read_at (inode->tmpfs, buffer, size, offset);
+
   while (size > 0) 
     {
       /* Disk sector to read, starting byte offset within sector. */
@@ -220,10 +270,37 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE
+          && !is_user_vaddr (buffer))
         {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
+          /* Read every full sector left in the request directly
+             into caller's buffer.  File data is contiguous on disk,
+             so they go to the device as a single run. */
+          off_t run_bytes = size < inode_left ? size : inode_left;
+          block_sector_t run = run_bytes / BLOCK_SECTOR_SIZE;
+          block_read_multiple (fs_device, sector_idx, run,
+                               buffer + bytes_read);
+          chunk_size = run * BLOCK_SECTOR_SIZE;
+        }
+      else if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+        {
+          /* A user buffer may be evicted while the device sleeps,
+             and faulting it back in mid-transfer would re-enter
+             the block layer, so full sectors for user memory go
+             through the bounce buffer, up to a page at a time. */
+          off_t run_bytes = size < inode_left ? size : inode_left;
+          block_sector_t run = run_bytes / BLOCK_SECTOR_SIZE;
+          if (run > BOUNCE_SECTORS)
+            run = BOUNCE_SECTORS;
+          if (bounce == NULL) 
+            {
+              bounce = palloc_get_page (0);
+              if (bounce == NULL)
+                break;
+            }
+          block_read_multiple (fs_device, sector_idx, run, bounce);
+          chunk_size = run * BLOCK_SECTOR_SIZE;
+          memcpy (buffer + bytes_read, bounce, chunk_size);
         }
       else 
         {
@@ -231,7 +308,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
              into caller's buffer. */
           if (bounce == NULL) 
             {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
+              bounce = palloc_get_page (0);
               if (bounce == NULL)
                 break;
             }
@@ -244,7 +321,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
+  palloc_free_page (bounce);
 
   return bytes_read;
 }
@@ -264,6 +341,8 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
   if (inode->deny_write_cnt)
     return 0;
+  if (inode->tmpfs != NULL)
+    return tmpfs_write_at (inode->tmpfs, buffer, size, offset);
 
   while (size > 0) 
     {
@@ -281,17 +360,41 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE
+          && !is_user_vaddr (buffer))
         {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
+          /* Write every full sector left in the request directly
+             to disk as a single contiguous run. */
+          off_t run_bytes = size < inode_left ? size : inode_left;
+          block_sector_t run = run_bytes / BLOCK_SECTOR_SIZE;
+          block_write_multiple (fs_device, sector_idx, run,
+                                buffer + bytes_written);
+          chunk_size = run * BLOCK_SECTOR_SIZE;
+        }
+      else if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+        {
+          /* Full sectors from user memory go through the bounce
+             buffer, as in inode_read_at(). */
+          off_t run_bytes = size < inode_left ? size : inode_left;
+          block_sector_t run = run_bytes / BLOCK_SECTOR_SIZE;
+          if (run > BOUNCE_SECTORS)
+            run = BOUNCE_SECTORS;
+          if (bounce == NULL) 
+            {
+              bounce = palloc_get_page (0);
+              if (bounce == NULL)
+                break;
+            }
+          chunk_size = run * BLOCK_SECTOR_SIZE;
+          memcpy (bounce, buffer + bytes_written, chunk_size);
+          block_write_multiple (fs_device, sector_idx, run, bounce);
         }
       else 
         {
           /* We need a bounce buffer. */
           if (bounce == NULL) 
             {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
+              bounce = palloc_get_page (0);
               if (bounce == NULL)
                 break;
             }
@@ -312,7 +415,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
+  palloc_free_page (bounce);
 
   return bytes_written;
 }
@@ -341,5 +444,7 @@ inode_allow_write (struct inode *inode)
 off_t
 inode_length (const struct inode *inode)
 {
+  if (inode->tmpfs != NULL)
+    return tmpfs_length (inode->tmpfs);
   return inode->data.length;
 }
@@ -6,10 +6,12 @@
 #include "devices/block.h"
 
 struct bitmap;
+struct tmpfs_file;
 
 void inode_init (void);
 bool inode_create (block_sector_t, off_t);
 struct inode *inode_open (block_sector_t);
+struct inode *inode_open_tmpfs (struct tmpfs_file *);
 struct inode *inode_reopen (struct inode *);
 block_sector_t inode_get_inumber (const struct inode *);
 void inode_close (struct inode *);
@@ -0,0 +1,259 @@
+#include "filesys/tmpfs.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* An in-memory file system mounted at TMPFS_MOUNT.
+
+   Each file's contents are kept in whole pages obtained from
+   the page allocator, indexed by a per-file array of page
+   pointers, so that a byte offset maps to its page with a single
+   division.  Pages are allocated on first write; pages that were
+   never written read back as zeros.  Unlike the disk file
+   system, files grow when written past their end.
+
+   Files are reached through the ordinary file.c interface.
+   tmpfs_open() returns a `struct inode' from inode.c that points
+   back at the tmpfs_file, and inode.c hands reads and writes on
+   such inodes to tmpfs_read_at() and tmpfs_write_at().  Nothing
+   here ever touches a block device.
+
+   Like the disk file system, the namespace is a single flat
+   directory, and callers are expected to serialize access. */
+
+/* An in-memory file. */
+struct tmpfs_file
+  {
+    struct list_elem elem;              /* Element in `files'. */
+    char name[NAME_MAX + 1];            /* Null terminated file name. */
+    off_t length;                       /* File size in bytes. */
+    size_t page_cnt;                    /* Number of entries in `pages'. */
+    uint8_t **pages;                    /* Data pages, null if never written. */
+  };
+
+/* Files currently linked into the tmpfs namespace. */
+static struct list files;
+
+static struct tmpfs_file *lookup (const char *name);
+static bool reserve_pages (struct tmpfs_file *, size_t page_cnt);
+
+/* Initializes the in-memory file system. */
+void
+tmpfs_init (void)
+{
+  list_init (&files);
+}
+
+/* Returns true if NAME lies under the tmpfs mount point, in
+   which case *TMP_NAME is set to NAME with the mount point
+   stripped off. */
+bool
+tmpfs_path (const char *name, const char **tmp_name)
+{
+  size_t mount_len = sizeof TMPFS_MOUNT - 1;
+
+  if (strnlen (name, mount_len) < mount_len
+      || memcmp (name, TMPFS_MOUNT, mount_len))
+    return false;
+  *tmp_name = name + mount_len;
+  return true;
+}
+
+/* Creates a file named NAME with the given INITIAL_SIZE, which
+   reads as zeros.  Returns true if successful, false if NAME is
+   empty or too long, if a file named NAME already exists, or if
+   memory allocation fails. */
+bool
+tmpfs_create (const char *name, off_t initial_size)
+{
+  struct tmpfs_file *tf;
+
+  ASSERT (initial_size >= 0);
+
+  if (*name == '\0' || strlen (name) > NAME_MAX || lookup (name) != NULL)
+    return false;
+
+  tf = malloc (sizeof *tf);
+  if (tf == NULL)
+    return false;
+  strlcpy (tf->name, name, sizeof tf->name);
+  tf->length = initial_size;
+  tf->page_cnt = 0;
+  tf->pages = NULL;
+  if (!reserve_pages (tf, DIV_ROUND_UP (initial_size, PGSIZE)))
+    {
+      free (tf);
+      return false;
+    }
+
+  list_push_front (&files, &tf->elem);
+  return true;
+}
+
+/* Opens the file named NAME and returns its inode, or a null
+   pointer if no such file exists or memory allocation fails. */
+struct inode *
+tmpfs_open (const char *name)
+{
+  struct tmpfs_file *tf = lookup (name);
+  return tf != NULL ? inode_open_tmpfs (tf) : NULL;
+}
+
+/* Removes the file named NAME.  Its memory is released once the
+   last opener closes it.  Returns true if successful, false if
+   no file named NAME exists. */
+bool
+tmpfs_remove (const char *name)
+{
+  struct tmpfs_file *tf = lookup (name);
+  struct inode *inode;
+
+  if (tf == NULL)
+    return false;
+
+  inode = inode_open_tmpfs (tf);
+  if (inode == NULL)
+    return false;
+  list_remove (&tf->elem);
+  inode_remove (inode);
+  inode_close (inode);
+  return true;
+}
+
+/* Reads SIZE bytes from TF into BUFFER, starting at OFFSET.
+   Returns the number of bytes actually read, which may be less
+   than SIZE if end of file is reached. */
+off_t
+tmpfs_read_at (struct tmpfs_file *tf, void *buffer_, off_t size,
+               off_t offset)
+{
+  uint8_t *buffer = buffer_;
+  off_t bytes_read = 0;
+
+  while (size > 0 && offset < tf->length)
+    {
+      size_t page_idx = offset / PGSIZE;
+      int page_ofs = offset % PGSIZE;
+      off_t file_left = tf->length - offset;
+      int page_left = PGSIZE - page_ofs;
+      int chunk_size = size < page_left ? size : page_left;
+      if (chunk_size > file_left)
+        chunk_size = file_left;
+
+      if (tf->pages[page_idx] != NULL)
+        memcpy (buffer + bytes_read, tf->pages[page_idx] + page_ofs,
+                chunk_size);
+      else
+        memset (buffer + bytes_read, 0, chunk_size);
+
+      size -= chunk_size;
+      offset += chunk_size;
+      bytes_read += chunk_size;
+    }
+
+  return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER into TF, starting at OFFSET,
+   extending the file if necessary.  Returns the number of bytes
+   actually written, which may be less than SIZE if memory runs
+   out. */
+off_t
+tmpfs_write_at (struct tmpfs_file *tf, const void *buffer_, off_t size,
+                off_t offset)
+{
+  const uint8_t *buffer = buffer_;
+  off_t bytes_written = 0;
+
+  if (size <= 0 || !reserve_pages (tf, DIV_ROUND_UP (offset + size, PGSIZE)))
+    return 0;
+
+  while (size > 0)
+    {
+      size_t page_idx = offset / PGSIZE;
+      int page_ofs = offset % PGSIZE;
+      int page_left = PGSIZE - page_ofs;
+      int chunk_size = size < page_left ? size : page_left;
+
+      if (tf->pages[page_idx] == NULL)
+        {
+          tf->pages[page_idx] = palloc_get_page (PAL_ZERO);
+          if (tf->pages[page_idx] == NULL)
+            break;
+        }
+      memcpy (tf->pages[page_idx] + page_ofs, buffer + bytes_written,
+              chunk_size);
+
+      size -= chunk_size;
+      offset += chunk_size;
+      bytes_written += chunk_size;
+    }
+
+  if (offset > tf->length)
+    tf->length = offset;
+  return bytes_written;
+}
+
+/* Returns the length, in bytes, of TF's data. */
+off_t
+tmpfs_length (const struct tmpfs_file *tf)
+{
+  return tf->length;
+}
+
+/* Frees TF and all of its data pages.  Called by inode.c when
+   the last opener of a removed file closes it. */
+void
+tmpfs_destroy (struct tmpfs_file *tf)
+{
+  size_t i;
+
+  for (i = 0; i < tf->page_cnt; i++)
+    palloc_free_page (tf->pages[i]);
+  free (tf->pages);
+  free (tf);
+}
+
+/* Returns the linked file named NAME, or a null pointer if there
+   is none. */
+static struct tmpfs_file *
+lookup (const char *name)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&files); e != list_end (&files); e = list_next (e))
+    {
+      struct tmpfs_file *tf = list_entry (e, struct tmpfs_file, elem);
+      if (!strcmp (name, tf->name))
+        return tf;
+    }
+  return NULL;
+}
+
+/* Grows TF's page index to at least PAGE_CNT entries.  The new
+   entries are null, meaning the pages have never been written.
+   Returns true if successful, false if memory allocation
+   fails. */
+static bool
+reserve_pages (struct tmpfs_file *tf, size_t page_cnt)
+{
+  uint8_t **pages;
+
+  if (page_cnt <= tf->page_cnt)
+    return true;
+
+  pages = realloc (tf->pages, page_cnt * sizeof *pages);
+  if (pages == NULL)
+    return false;
+  memset (pages + tf->page_cnt, 0,
+          (page_cnt - tf->page_cnt) * sizeof *pages);
+  tf->pages = pages;
+  tf->page_cnt = page_cnt;
+  return true;
+}
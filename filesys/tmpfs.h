@@ -0,0 +1,30 @@
+#ifndef FILESYS_TMPFS_H
+#define FILESYS_TMPFS_H
+
+#include <stdbool.h>
+#include "filesys/off_t.h"
+
+/* Mount point of the in-memory file system.  Names that begin
+   with this prefix are created in memory rather than on the file
+   system device. */
+#define TMPFS_MOUNT "/tmp/"
+
+struct inode;
+struct tmpfs_file;
+
+void tmpfs_init (void);
+bool tmpfs_path (const char *name, const char **tmp_name);
+
+/* Namespace operations, called by filesys.c. */
+bool tmpfs_create (const char *name, off_t initial_size);
+struct inode *tmpfs_open (const char *name);
+bool tmpfs_remove (const char *name);
+
+/* Data operations, called by inode.c. */
+off_t tmpfs_read_at (struct tmpfs_file *, void *, off_t size, off_t offset);
+off_t tmpfs_write_at (struct tmpfs_file *, const void *, off_t size,
+                      off_t offset);
+off_t tmpfs_length (const struct tmpfs_file *);
+void tmpfs_destroy (struct tmpfs_file *);
+
+#endif /* filesys/tmpfs.h */
@@ -0,0 +1,225 @@
+#include "lz.h"
+#include <stdbool.h>
+#include <string.h>
+#include "debug.h"
+
+/* Compressed data is a series of sequences, each of which is:
+
+        - A token byte.  Its high 4 bits are the number of literal
+          bytes that follow, its low 4 bits the match length minus
+          MIN_MATCH.  A field value of 15 means that the length
+          continues in the following bytes, each of which adds its
+          value, until one less than 255.
+
+        - The literal bytes, copied to the output as-is.
+
+        - A 2-byte little-endian offset, counting back from the
+          current output position, and the match continuation
+          bytes, if any.  The match is then copied from earlier
+          output; it may overlap the bytes it produces.
+
+   The last sequence stops after its literals, which is how the
+   decompressor knows it is the last. */
+
+/* Shortest match worth encoding. */
+#define MIN_MATCH 4
+
+/* Number of bits in a hash of MIN_MATCH bytes. */
+#define HASH_BITS 12
+
+/* Largest offset a match may have. */
+#define MAX_OFFSET 65535
+
+/* Bytes at the end of the input that are always emitted as
+   literals, so that the match search may read 4 bytes at a
+   time without running off the end. */
+#define LAST_LITERALS 5
+
+/* Reads 4 bytes from P, which need not be aligned. */
+static inline uint32_t
+read32 (const uint8_t *p)
+{
+  uint32_t x;
+  memcpy (&x, p, sizeof x);
+  return x;
+}
+
+/* Returns a hash of the 4 bytes in X. */
+static inline unsigned
+hash32 (uint32_t x)
+{
+  return (x * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Appends LENGTH, less the 15 already counted in a token, to the
+   output at *OP, which must not pass END.  Returns false if it
+   would. */
+static bool
+put_length (uint8_t **op, uint8_t *end, size_t length)
+{
+  for (length -= 15; ; length -= 255)
+    {
+      if (*op >= end)
+        return false;
+      if (length < 255)
+        {
+          *(*op)++ = length;
+          return true;
+        }
+      *(*op)++ = 255;
+    }
+}
+
+/* Appends a sequence of LIT_LEN literals from LIT followed, if
+   MATCH_LEN is nonzero, by a match of MATCH_LEN bytes at OFFSET,
+   to the output at *OP, which must not pass END.  Returns false
+   if it would. */
+static bool
+put_sequence (uint8_t **op, uint8_t *end, const uint8_t *lit,
+              size_t lit_len, size_t offset, size_t match_len)
+{
+  size_t match_code = match_len ? match_len - MIN_MATCH : 0;
+  uint8_t *token = *op;
+
+  if (*op >= end)
+    return false;
+  *token = ((lit_len < 15 ? lit_len : 15) << 4
+            | (match_code < 15 ? match_code : 15));
+  (*op)++;
+
+  if (lit_len >= 15 && !put_length (op, end, lit_len))
+    return false;
+  if ((size_t) (end - *op) < lit_len)
+    return false;
+  memcpy (*op, lit, lit_len);
+  *op += lit_len;
+
+  if (match_len == 0)
+    return true;
+  if (end - *op < 2)
+    return false;
+  *(*op)++ = offset & 0xff;
+  *(*op)++ = offset >> 8;
+  return match_code < 15 || put_length (op, end, match_code);
+}
+
+/* Compresses the SRC_SIZE bytes at SRC, which must be no more
+   than LZ_MAX_INPUT, into the DST_SIZE bytes at DST, using the
+   LZ_WORK_SIZE bytes at WORK as scratch space.  Returns the size
+   of the compressed data, or 0 if it would not fit in DST_SIZE
+   bytes, in which case the data is best stored uncompressed. */
+size_t
+lz_compress (const void *src_, size_t src_size,
+             void *dst_, size_t dst_size, void *work)
+{
+  const uint8_t *src = src_;
+  uint8_t *dst = dst_;
+  uint8_t *op = dst, *end = dst + dst_size;
+  uint16_t *table = work;
+  size_t ip = 0, anchor = 0;
+
+  ASSERT (src != NULL || src_size == 0);
+  ASSERT (src_size <= LZ_MAX_INPUT);
+
+  memset (table, 0, LZ_WORK_SIZE);
+  if (src_size > MIN_MATCH + LAST_LITERALS)
+    while (ip + MIN_MATCH + LAST_LITERALS <= src_size)
+      {
+        uint32_t seq = read32 (src + ip);
+        unsigned h = hash32 (seq);
+        size_t ref = table[h];
+        size_t len;
+
+        table[h] = ip;
+        if (ref >= ip || ip - ref > MAX_OFFSET || read32 (src + ref) != seq)
+          {
+            ip++;
+            continue;
+          }
+
+        /* Extend the match as far as it goes. */
+        len = MIN_MATCH;
+        while (ip + len < src_size - LAST_LITERALS
+               && src[ref + len] == src[ip + len])
+          len++;
+
+        if (!put_sequence (&op, end, src + anchor, ip - anchor,
+                           ip - ref, len))
+          return 0;
+        ip += len;
+        anchor = ip;
+      }
+
+  if (!put_sequence (&op, end, src + anchor, src_size - anchor, 0, 0))
+    return 0;
+  return op - dst;
+}
+
+/* Reads a length continuation from the input at *IP, which must
+   not pass END, and adds it to *LENGTH.  Returns false if the
+   input ends first. */
+static bool
+get_length (const uint8_t **ip, const uint8_t *end, size_t *length)
+{
+  uint8_t b;
+
+  do
+    {
+      if (*ip >= end)
+        return false;
+      b = *(*ip)++;
+      *length += b;
+    }
+  while (b == 255);
+  return true;
+}
+
+/* Decompresses the SRC_SIZE bytes of lz_compress() output at SRC
+   into the DST_SIZE bytes at DST.  Returns the size of the
+   decompressed data, or 0 if SRC is corrupt or the data would
+   not fit in DST_SIZE bytes. */
+size_t
+lz_decompress (const void *src_, size_t src_size,
+               void *dst_, size_t dst_size)
+{
+  const uint8_t *ip = src_, *ip_end = ip + src_size;
+  uint8_t *dst = dst_;
+  uint8_t *op = dst, *op_end = dst + dst_size;
+
+  while (ip < ip_end)
+    {
+      uint8_t token = *ip++;
+      size_t lit_len = token >> 4;
+      size_t match_len = token & 15;
+      size_t offset;
+
+      if (lit_len == 15 && !get_length (&ip, ip_end, &lit_len))
+        return 0;
+      if ((size_t) (ip_end - ip) < lit_len
+          || (size_t) (op_end - op) < lit_len)
+        return 0;
+      memcpy (op, ip, lit_len);
+      ip += lit_len;
+      op += lit_len;
+
+      /* The last sequence has no match. */
+      if (ip == ip_end)
+        break;
+
+      if (ip_end - ip < 2)
+        return 0;
+      offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+      if (match_len == 15 && !get_length (&ip, ip_end, &match_len))
+        return 0;
+      match_len += MIN_MATCH;
+      if (offset == 0 || offset > (size_t) (op - dst)
+          || (size_t) (op_end - op) < match_len)
+        return 0;
+
+      /* Byte at a time, since the match may overlap its output. */
+      for (; match_len > 0; match_len--, op++)
+        *op = op[-offset];
+    }
+  return op - dst;
+}
@@ -0,0 +1,24 @@
+#ifndef __LIB_LZ_H
+#define __LIB_LZ_H
+
+/* Fast LZ77-style compression, in the spirit of LZ4: no entropy
+   coding, just literal runs and back references into data
+   already seen, so that both directions run at close to memory
+   speed.  Meant for small blocks such as pages, not for
+   archives. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Largest input lz_compress() accepts. */
+#define LZ_MAX_INPUT 65536
+
+/* Bytes of scratch memory lz_compress() needs. */
+#define LZ_WORK_SIZE (4096 * sizeof (uint16_t))
+
+size_t lz_compress (const void *src, size_t src_size,
+                    void *dst, size_t dst_size, void *work);
+size_t lz_decompress (const void *src, size_t src_size,
+                      void *dst, size_t dst_size);
+
+#endif /* lib/lz.h */
@@ -30,7 +30,14 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_SBRK,                   /* Grow or shrink the heap. */
+    SYS_FORK,                   /* Clone the current process. */
+    SYS_YIELD,                  /* Let another process run. */
+    SYS_GETPID,                 /* Get the current process's id. */
+    SYS_RING_ENTER              /* Carry out requests from a system call ring. */
   };
 
 #endif /* lib/syscall-nr.h */
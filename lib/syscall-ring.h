@@ -0,0 +1,66 @@
+#ifndef __LIB_SYSCALL_RING_H
+#define __LIB_SYSCALL_RING_H
+
+#include <stdint.h>
+
+/* System call ring.
+
+   A user process queues up read, write, open, close, and seek
+   requests in a ring in its own memory, then has the kernel
+   carry out as many of them as it likes with one ring_enter()
+   system call, instead of trapping once per request.  The kernel
+   carries out requests in order and posts one result for each in
+   a second ring, which the process drains at leisure.
+
+   Both rings use free-running indexes: the producer advances the
+   tail, the consumer the head, and entry I lives in slot
+   I % RING_ENTRIES.  A ring is empty when its head equals its
+   tail and full when they are RING_ENTRIES apart.  The process
+   owns sq_tail and cq_head, the kernel sq_head and cq_tail.
+
+   The kernel only looks at the ring during ring_enter(), so
+   nothing needs to be atomic. */
+
+/* Number of slots in each ring.  Must be a power of 2. */
+#define RING_ENTRIES 64
+
+/* Operations. */
+enum ring_op
+  {
+    RING_NOP,                   /* Do nothing, result 0. */
+    RING_READ,                  /* read (FD, BUF, SIZE). */
+    RING_WRITE,                 /* write (FD, BUF, SIZE). */
+    RING_OPEN,                  /* open (BUF), result the fd. */
+    RING_CLOSE,                 /* close (FD), result 0. */
+    RING_SEEK                   /* seek (FD, SIZE), result 0. */
+  };
+
+/* A request, in the submission ring. */
+struct ring_request
+  {
+    int op;                     /* One of enum ring_op. */
+    int fd;                     /* File descriptor. */
+    void *buf;                  /* Buffer, or file name for RING_OPEN. */
+    unsigned size;              /* Buffer size, or position for RING_SEEK. */
+    uint32_t tag;               /* Copied into the result. */
+  };
+
+/* A result, in the completion ring. */
+struct ring_result
+  {
+    int result;                 /* What the system call would return. */
+    uint32_t tag;               /* Tag of the request. */
+  };
+
+/* A pair of rings. */
+struct syscall_ring
+  {
+    unsigned sq_head;           /* Next request the kernel takes. */
+    unsigned sq_tail;           /* Next free request slot. */
+    unsigned cq_head;           /* Next result the process takes. */
+    unsigned cq_tail;           /* Next free result slot. */
+    struct ring_request sq[RING_ENTRIES];
+    struct ring_result cq[RING_ENTRIES];
+  };
+
+#endif /* lib/syscall-ring.h */
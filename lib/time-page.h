@@ -0,0 +1,40 @@
+#ifndef __LIB_TIME_PAGE_H
+#define __LIB_TIME_PAGE_H
+
+#include <stdint.h>
+
+/* Time page.
+
+   The kernel maps one read-only page of timekeeping data into
+   every user process at TIME_PAGE_ADDR, and keeps it up to date
+   from the timer interrupt, so that a process can read the time
+   without a system call.
+
+   The page is guarded by a sequence count: the kernel makes SEQ
+   odd before it changes anything and even again afterward, so a
+   reader takes SEQ, reads the fields, and starts over if SEQ was
+   odd or has changed since.
+
+   Between ticks, the time can be interpolated from the
+   time-stamp counter: TSC cycles since TICK_TSC, times TSC_MULT,
+   shifted right by TIME_TSC_SHIFT, gives nanoseconds since the
+   last tick.  TSC_MULT is 0 until the kernel has measured the
+   TSC rate, or if there is no TSC. */
+
+/* User virtual address of the time page.  Below where
+   executables are normally loaded. */
+#define TIME_PAGE_ADDR 0x08000000
+
+/* Binary point of TSC_MULT. */
+#define TIME_TSC_SHIFT 24
+
+struct time_page
+  {
+    uint32_t seq;               /* Odd while being updated. */
+    uint32_t ns_per_tick;       /* Nanoseconds per timer tick. */
+    int64_t ticks;              /* Timer ticks since boot. */
+    uint64_t tick_tsc;          /* TSC at the last tick. */
+    uint32_t tsc_mult;          /* Nanoseconds per cycle, fixed point. */
+  };
+
+#endif /* lib/time-page.h */
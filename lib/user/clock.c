@@ -0,0 +1,82 @@
+#include <clock.h>
+#include <time-page.h>
+
+/* Clocks.
+
+   Both functions read the time page that the kernel maps into
+   every process and updates on each timer tick (see
+   lib/time-page.h), so they never enter the kernel and cost
+   little more than a few memory reads.  That makes them fit for
+   timestamping the very things being timed. */
+
+/* The time page.  Volatile, because the kernel changes it
+   behind our back. */
+static const volatile struct time_page *const time_page
+  = (const volatile struct time_page *) TIME_PAGE_ADDR;
+
+/* A consistent copy of the time page's contents. */
+struct time_snapshot
+  {
+    int64_t ticks;
+    uint64_t tick_tsc;
+    uint32_t tsc_mult;
+    uint32_t ns_per_tick;
+  };
+
+/* Copies the time page into S, trying again if a timer tick
+   changed it while we were reading. */
+static void
+read_time_page (struct time_snapshot *s)
+{
+  uint32_t seq;
+
+  do
+    {
+      seq = time_page->seq;
+      s->ticks = time_page->ticks;
+      s->tick_tsc = time_page->tick_tsc;
+      s->tsc_mult = time_page->tsc_mult;
+      s->ns_per_tick = time_page->ns_per_tick;
+    }
+  while ((seq & 1) != 0 || seq != time_page->seq);
+}
+
+/* Returns the number of timer ticks since the OS booted. */
+int64_t
+clock_ticks (void)
+{
+  struct time_snapshot s;
+
+  read_time_page (&s);
+  return s.ticks;
+}
+
+/* Returns the number of nanoseconds since the OS booted.  Has the
+   resolution of a timer tick, refined by the time-stamp counter
+   once the kernel has measured its rate.  Never goes backward. */
+uint64_t
+clock_ns (void)
+{
+  struct time_snapshot s;
+  uint64_t tsc, cycles;
+  uint32_t since_tick = 0;
+
+  read_time_page (&s);
+  if (s.tsc_mult != 0)
+    {
+      asm volatile ("rdtsc" : "=A" (tsc));
+      cycles = tsc - s.tick_tsc;
+
+      /* Interpolate within the tick, but stop short of the next
+         one, which may be running late. */
+      since_tick = s.ns_per_tick - 1;
+      if (cycles <= UINT32_MAX)
+        {
+          uint64_t ns = ((uint64_t) (uint32_t) cycles * s.tsc_mult
+                         >> TIME_TSC_SHIFT);
+          if (ns < since_tick)
+            since_tick = ns;
+        }
+    }
+  return (uint64_t) s.ticks * s.ns_per_tick + since_tick;
+}
@@ -0,0 +1,230 @@
+#include <malloc.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* User-space memory allocator.
+
+   Memory comes from the heap, which the kernel grows with
+   sbrk() and fills with zeroed pages only as they are touched.
+   The heap is carved, a block at a time, out of "chunks" of at
+   least CHUNK_SIZE bytes obtained from sbrk().
+
+   Requests of up to 2 kB are rounded up to one of a set of size
+   classes, spaced 16 bytes apart up to 128 bytes and about 1.5x
+   apart above that.  Each class has its own free list of blocks
+   of exactly its size, so allocation and freeing are a list pop
+   and push, with no searching, splitting, or merging.  This is
+   the per-thread free-list ("thread cache") design of
+   multithreaded allocators; since a Pintos process has exactly
+   one thread, the cache never needs a lock or a slower shared
+   level behind it.
+
+   Larger blocks are kept on a single free list searched first
+   fit, and are carved directly from the heap when none fits.
+
+   Every block is preceded by a header recording its class and
+   usable size, so that free() and realloc() need only the
+   pointer. */
+
+/* Header in front of every block. */
+struct header
+  {
+    size_t size;                /* Usable size in bytes. */
+    unsigned class;             /* Size class, or BIG_CLASS. */
+  };
+
+/* A free block, overlaying the block's usable space. */
+struct free_block
+  {
+    struct free_block *next;    /* Next block in free list. */
+  };
+
+/* Usable sizes of the size classes. */
+static const size_t class_size[] =
+  {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    192, 256, 384, 512, 768, 1024, 1536, 2048,
+  };
+#define CLASS_CNT (sizeof class_size / sizeof *class_size)
+#define SMALL_MAX 128           /* Classes up to here are 16 bytes apart. */
+#define BIG_CLASS CLASS_CNT     /* Class of blocks too big for any class. */
+
+/* Minimum number of bytes requested from sbrk() at a time. */
+#define CHUNK_SIZE (16 * 1024)
+
+/* Largest request malloc() tries to satisfy.  Anything bigger
+   could not be passed to sbrk() as a positive increment once the
+   header is added and it is rounded up to a whole chunk, and
+   would make that arithmetic wrap around. */
+#define MALLOC_MAX (PTRDIFF_MAX - CHUNK_SIZE - sizeof (struct header))
+
+/* Free lists, one per class plus one for big blocks. */
+static struct free_block *free_lists[CLASS_CNT + 1];
+
+/* Unallocated part of the current chunk. */
+static uint8_t *chunk_next, *chunk_end;
+
+/* Returns the class for a SIZE-byte request, where SIZE is
+   nonzero, or BIG_CLASS if SIZE is too big for any class. */
+static unsigned
+size_to_class (size_t size)
+{
+  unsigned class;
+
+  if (size <= SMALL_MAX)
+    return (size - 1) / 16;
+  for (class = SMALL_MAX / 16; class < CLASS_CNT; class++)
+    if (class_size[class] >= size)
+      return class;
+  return BIG_CLASS;
+}
+
+/* Carves a block with SIZE usable bytes from the current chunk,
+   extending the heap if the chunk is too small.  Returns its
+   header, or a null pointer if the heap cannot grow. */
+static struct header *
+carve (size_t size)
+{
+  size_t need = sizeof (struct header) + size;
+  struct header *h;
+
+  if ((size_t) (chunk_end - chunk_next) < need)
+    {
+      size_t grow = ROUND_UP (need, CHUNK_SIZE);
+      uint8_t *p;
+
+      ASSERT (grow <= INTPTR_MAX);
+      p = sbrk (grow);
+      if (p == (uint8_t *) -1)
+        return NULL;
+
+      /* The new memory usually continues the current chunk.  If
+         something else moved the break in between, the rest of
+         the old chunk is abandoned. */
+      if (p != chunk_end)
+        chunk_next = p;
+      chunk_end = p + grow;
+    }
+
+  h = (struct header *) chunk_next;
+  chunk_next += need;
+  h->size = size;
+  return h;
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size)
+{
+  unsigned class;
+  struct free_block **list, *b;
+  struct header *h;
+
+  if (size == 0 || size > MALLOC_MAX)
+    return NULL;
+
+  class = size_to_class (size);
+  list = &free_lists[class];
+  if (class != BIG_CLASS)
+    {
+      b = *list;
+      if (b != NULL)
+        {
+          *list = b->next;
+          return b;
+        }
+      h = carve (class_size[class]);
+    }
+  else
+    {
+      /* Reuse the first big block that is large enough. */
+      size = ROUND_UP (size, sizeof (struct header));
+      for (; *list != NULL; list = &(*list)->next)
+        {
+          h = (struct header *) *list - 1;
+          if (h->size >= size)
+            {
+              b = *list;
+              *list = b->next;
+              return b;
+            }
+        }
+      h = carve (size);
+    }
+
+  if (h == NULL)
+    return NULL;
+  h->class = class;
+  return h + 1;
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b)
+{
+  void *p;
+  size_t size;
+
+  /* Calculate block size and make sure it fits in size_t. */
+  size = a * b;
+  if (size < a || size < b)
+    return NULL;
+
+  /* Allocate and zero memory. */
+  p = malloc (size);
+  if (p != NULL)
+    memset (p, 0, size);
+
+  return p;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size)
+{
+  if (new_size == 0)
+    {
+      free (old_block);
+      return NULL;
+    }
+  else if (old_block != NULL
+           && ((struct header *) old_block - 1)->size >= new_size)
+    return old_block;
+  else
+    {
+      void *new_block = malloc (new_size);
+      if (old_block != NULL && new_block != NULL)
+        {
+          memcpy (new_block, old_block,
+                  ((struct header *) old_block - 1)->size);
+          free (old_block);
+        }
+      return new_block;
+    }
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p)
+{
+  if (p != NULL)
+    {
+      struct header *h = (struct header *) p - 1;
+      struct free_block *b = p;
+
+      ASSERT (h->class <= BIG_CLASS);
+      b->next = free_lists[h->class];
+      free_lists[h->class] = b;
+    }
+}
@@ -0,0 +1,115 @@
+#include <ring.h>
+#include <string.h>
+#include <syscall.h>
+
+/* System call rings.
+
+   A ring lets a program queue up several file system calls and
+   have the kernel carry them all out with a single ring_enter()
+   system call, which pays off when there are many small ones.
+   The layout of the ring is in lib/syscall-ring.h.
+
+   Queue requests with ring_read() and friends, which return
+   false if the submission ring is full, then call ring_submit()
+   and take the results off with ring_reap().  Results come back
+   in the order the requests went in, each carrying the tag of
+   its request.  Requests run when ring_submit() is called, not
+   when they are queued, so their buffers and file names must stay
+   valid until then.  ring_submit() stops short if the completion
+   ring fills up, so reap results before queueing more than
+   RING_ENTRIES requests in total. */
+
+/* Makes RING empty. */
+void
+ring_init (struct syscall_ring *ring)
+{
+  memset (ring, 0, sizeof *ring);
+}
+
+/* Queues a request for OP on RING.  Returns false if the
+   submission ring is full. */
+static bool
+queue (struct syscall_ring *ring, int op, int fd, void *buf,
+       unsigned size, uint32_t tag)
+{
+  struct ring_request *rq;
+
+  if (ring->sq_tail - ring->sq_head >= RING_ENTRIES)
+    return false;
+  rq = &ring->sq[ring->sq_tail % RING_ENTRIES];
+  rq->op = op;
+  rq->fd = fd;
+  rq->buf = buf;
+  rq->size = size;
+  rq->tag = tag;
+  ring->sq_tail++;
+  return true;
+}
+
+/* Queues read (FD, BUFFER, SIZE) on RING. */
+bool
+ring_read (struct syscall_ring *ring, int fd, void *buffer, unsigned size,
+           uint32_t tag)
+{
+  return queue (ring, RING_READ, fd, buffer, size, tag);
+}
+
+/* Queues write (FD, BUFFER, SIZE) on RING. */
+bool
+ring_write (struct syscall_ring *ring, int fd, const void *buffer,
+            unsigned size, uint32_t tag)
+{
+  return queue (ring, RING_WRITE, fd, (void *) buffer, size, tag);
+}
+
+/* Queues open (FILE) on RING. */
+bool
+ring_open (struct syscall_ring *ring, const char *file, uint32_t tag)
+{
+  return queue (ring, RING_OPEN, -1, (void *) file, 0, tag);
+}
+
+/* Queues close (FD) on RING. */
+bool
+ring_close (struct syscall_ring *ring, int fd, uint32_t tag)
+{
+  return queue (ring, RING_CLOSE, fd, NULL, 0, tag);
+}
+
+/* Queues seek (FD, POSITION) on RING. */
+bool
+ring_seek (struct syscall_ring *ring, int fd, unsigned position,
+           uint32_t tag)
+{
+  return queue (ring, RING_SEEK, fd, NULL, position, tag);
+}
+
+/* Returns the number of requests queued on RING but not yet
+   carried out. */
+unsigned
+ring_pending (const struct syscall_ring *ring)
+{
+  return ring->sq_tail - ring->sq_head;
+}
+
+/* Has the kernel carry out every request queued on RING, or as
+   many as there is room for results, and returns how many it
+   did. */
+int
+ring_submit (struct syscall_ring *ring)
+{
+  unsigned pending = ring_pending (ring);
+  return pending > 0 ? ring_enter (ring, pending) : 0;
+}
+
+/* Takes the oldest result off RING and stores it in RESULT.
+   Returns false if there are none. */
+bool
+ring_reap (struct syscall_ring *ring, struct ring_result *result)
+{
+  if (ring->cq_head == ring->cq_tail)
+    return false;
+  *result = ring->cq[ring->cq_head % RING_ENTRIES];
+  ring->cq_head++;
+  return true;
+}
@@ -0,0 +1,22 @@
+#ifndef __LIB_USER_RING_H
+#define __LIB_USER_RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <syscall-ring.h>
+
+/* System call rings.  See ring.c. */
+void ring_init (struct syscall_ring *);
+bool ring_read (struct syscall_ring *, int fd, void *buffer,
+                unsigned size, uint32_t tag);
+bool ring_write (struct syscall_ring *, int fd, const void *buffer,
+                 unsigned size, uint32_t tag);
+bool ring_open (struct syscall_ring *, const char *file, uint32_t tag);
+bool ring_close (struct syscall_ring *, int fd, uint32_t tag);
+bool ring_seek (struct syscall_ring *, int fd, unsigned position,
+                uint32_t tag);
+unsigned ring_pending (const struct syscall_ring *);
+int ring_submit (struct syscall_ring *);
+bool ring_reap (struct syscall_ring *, struct ring_result *);
+
+#endif /* lib/user/ring.h */
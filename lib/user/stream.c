@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <malloc.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Buffered streams.
+
+   A stream wraps a file descriptor with a buffer, so that many
+   small reads or writes turn into a few large read() and write()
+   system calls.  A stream is either fully buffered, and only
+   writes its buffer when it fills up or is flushed; line
+   buffered, and also writes it out after each new-line; or
+   unbuffered, and passes every request straight through.
+
+   stdout is line buffered, since it is always the console.
+   stdin is unbuffered, because a console read() does not return
+   until it has all the bytes asked for.  Streams opened with
+   fopen() or fdopen() are fully buffered.  The buffer is
+   allocated on first use; if that fails, the stream falls back
+   to being unbuffered.
+
+   exit() and halt() flush every stream, so output is not lost
+   when a program ends. */
+
+/* What the buffer currently holds. */
+enum stream_state
+  {
+    IDLE,                       /* Nothing. */
+    READING,                    /* Data read ahead, from POS to END. */
+    WRITING                     /* Data to write, from BUF to POS. */
+  };
+
+/* A stream. */
+struct FILE
+  {
+    int fd;                     /* File descriptor. */
+    int mode;                   /* _IOFBF, _IOLBF, or _IONBF. */
+    enum stream_state state;    /* What the buffer holds. */
+    char *buf;                  /* Buffer, or null if not yet allocated. */
+    size_t size;                /* Size of buffer. */
+    char *pos;                  /* Current position in buffer. */
+    char *end;                  /* End of data read ahead. */
+    bool eof;                   /* End of file reached? */
+    bool error;                 /* Read or write failed? */
+    bool own_buf;               /* Free BUF on close? */
+    bool close_fd;              /* Close FD on close? */
+    struct FILE *next;          /* Next in list of all streams. */
+  };
+
+static FILE stdin_file = {STDIN_FILENO, _IONBF, IDLE, NULL, 0,
+                          NULL, NULL, false, false, false, false, NULL};
+static FILE stdout_file = {STDOUT_FILENO, _IOLBF, IDLE, NULL, 0,
+                           NULL, NULL, false, false, false, false,
+                           &stdin_file};
+
+FILE *stdin = &stdin_file;
+FILE *stdout = &stdout_file;
+
+/* All open streams, for fflush(NULL). */
+static FILE *all_streams = &stdout_file;
+
+/* Makes sure that buffered stream F has a buffer.  Returns false
+   if F is, or has had to become, unbuffered. */
+static bool
+have_buffer (FILE *f)
+{
+  if (f->mode == _IONBF)
+    return false;
+  if (f->buf == NULL)
+    {
+      f->buf = malloc (BUFSIZ);
+      if (f->buf == NULL)
+        {
+          f->mode = _IONBF;
+          return false;
+        }
+      f->size = BUFSIZ;
+      f->own_buf = true;
+      f->pos = f->end = f->buf;
+    }
+  return true;
+}
+
+/* Writes out any data buffered for writing in F.  Returns false
+   if the write fails. */
+static bool
+flush_writes (FILE *f)
+{
+  if (f->state == WRITING)
+    {
+      int cnt = f->pos - f->buf;
+      f->state = IDLE;
+      f->pos = f->buf;
+      if (cnt > 0 && write (f->fd, f->buf, cnt) != cnt)
+        {
+          f->error = true;
+          return false;
+        }
+    }
+  return true;
+}
+
+/* Discards any data read ahead into F's buffer, moving the file
+   position back to just after the data actually consumed. */
+static void
+drop_reads (FILE *f)
+{
+  if (f->state == READING)
+    {
+      if (f->end > f->pos)
+        seek (f->fd, tell (f->fd) - (f->end - f->pos));
+      f->state = IDLE;
+      f->pos = f->end = f->buf;
+    }
+}
+
+/* Opens and returns a fully buffered stream for the file named
+   NAME.  MODE "r" opens an existing file, "w" also creates it,
+   with length 0, if it does not exist, and "a" starts writing at
+   its end.  Files are not truncated, since the file system does
+   not support it.  Returns a null pointer on failure. */
+FILE *
+fopen (const char *name, const char *mode)
+{
+  FILE *f;
+  int fd;
+
+  fd = open (name);
+  if (fd < 0 && mode[0] == 'w' && create (name, 0))
+    fd = open (name);
+  if (fd < 0)
+    return NULL;
+  if (mode[0] == 'a')
+    seek (fd, filesize (fd));
+
+  f = fdopen (fd, mode);
+  if (f == NULL)
+    close (fd);
+  else
+    f->close_fd = true;
+  return f;
+}
+
+/* Returns a new stream for the already open file descriptor FD.
+   The stream is line buffered for the console and fully
+   buffered otherwise.  MODE is accepted for compatibility and
+   ignored.  Returns a null pointer if memory is not available. */
+FILE *
+fdopen (int fd, const char *mode UNUSED)
+{
+  FILE *f = calloc (1, sizeof *f);
+  if (f == NULL)
+    return NULL;
+
+  f->fd = fd;
+  f->mode = fd == STDOUT_FILENO ? _IOLBF : _IOFBF;
+  f->state = IDLE;
+  f->next = all_streams;
+  all_streams = f;
+  return f;
+}
+
+/* Flushes and closes F.  Returns 0 if successful, EOF if
+   buffered output could not be written. */
+int
+fclose (FILE *f)
+{
+  int retval = fflush (f);
+  FILE **fp;
+
+  for (fp = &all_streams; *fp != NULL; fp = &(*fp)->next)
+    if (*fp == f)
+      {
+        *fp = f->next;
+        break;
+      }
+
+  if (f->close_fd)
+    close (f->fd);
+  if (f->own_buf)
+    free (f->buf);
+  if (f != stdin && f != stdout)
+    free (f);
+  return retval;
+}
+
+/* Writes out any output buffered in F or, if F is a null
+   pointer, in every stream.  Data read ahead is discarded.
+   Returns 0 if successful, EOF if a write fails. */
+int
+fflush (FILE *f)
+{
+  if (f == NULL)
+    {
+      int retval = 0;
+      for (f = all_streams; f != NULL; f = f->next)
+        if (fflush (f) == EOF)
+          retval = EOF;
+      return retval;
+    }
+
+  drop_reads (f);
+  return flush_writes (f) ? 0 : EOF;
+}
+
+/* Sets F's buffering MODE to _IOFBF, _IOLBF, or _IONBF.  A
+   buffered stream uses the SIZE bytes at BUF, or a buffer of its
+   own if BUF is null.  Returns 0 if successful, EOF on error. */
+int
+setvbuf (FILE *f, char *buf, int mode, size_t size)
+{
+  if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF)
+    return EOF;
+
+  fflush (f);
+  if (f->own_buf && (buf != NULL || mode == _IONBF))
+    {
+      free (f->buf);
+      f->buf = NULL;
+      f->own_buf = false;
+    }
+  if (buf != NULL && mode != _IONBF && size > 0)
+    {
+      f->buf = buf;
+      f->size = size;
+      f->pos = f->end = buf;
+    }
+  f->mode = mode;
+  return 0;
+}
+
+/* Reads up to CNT elements of SIZE bytes each from F into BUF.
+   Returns the number of whole elements read, which is less than
+   CNT only at end of file or on error. */
+size_t
+fread (void *buf_, size_t size, size_t cnt, FILE *f)
+{
+  char *buf = buf_;
+  size_t total = size * cnt;
+  size_t done = 0;
+  int n = 0;
+
+  if (total == 0)
+    return 0;
+  if (!flush_writes (f))
+    return 0;
+
+  while (done < total)
+    {
+      size_t want = total - done;
+
+      if (f->state == READING && f->pos < f->end)
+        {
+          /* Take what is already buffered. */
+          n = f->end - f->pos;
+          if ((size_t) n > want)
+            n = want;
+          memcpy (buf + done, f->pos, n);
+          f->pos += n;
+          done += n;
+          continue;
+        }
+
+      if (!have_buffer (f) || want >= f->size)
+        {
+          /* Read straight into the caller's buffer. */
+          n = read (f->fd, buf + done, want);
+          if (n <= 0)
+            break;
+          done += n;
+        }
+      else
+        {
+          /* Refill the buffer. */
+          n = read (f->fd, f->buf, f->size);
+          if (n <= 0)
+            break;
+          f->state = READING;
+          f->pos = f->buf;
+          f->end = f->buf + n;
+        }
+    }
+
+  if (done < total)
+    {
+      if (n < 0)
+        f->error = true;
+      else
+        f->eof = true;
+    }
+  return done / size;
+}
+
+/* Writes CNT elements of SIZE bytes each from BUF to F.
+   Returns the number of elements written, which is less than CNT
+   only on error. */
+size_t
+fwrite (const void *buf, size_t size, size_t cnt, FILE *f)
+{
+  size_t total = size * cnt;
+
+  if (total == 0)
+    return 0;
+  drop_reads (f);
+
+  if (!have_buffer (f) || total >= f->size)
+    {
+      /* Too big to be worth copying, or unbuffered: write
+         whatever is pending and then BUF directly. */
+      int n;
+      if (!flush_writes (f))
+        return 0;
+      n = write (f->fd, buf, total);
+      if (n < 0 || (size_t) n != total)
+        {
+          f->error = true;
+          return n < 0 ? 0 : n / size;
+        }
+      return cnt;
+    }
+
+  if ((size_t) (f->buf + f->size - f->pos) < total && !flush_writes (f))
+    return 0;
+  f->state = WRITING;
+  memcpy (f->pos, buf, total);
+  f->pos += total;
+
+  if (f->pos == f->buf + f->size
+      || (f->mode == _IOLBF && memchr (buf, '\n', total) != NULL))
+    if (!flush_writes (f))
+      return 0;
+  return cnt;
+}
+
+/* Reads and returns one character from F as an unsigned char,
+   or EOF at end of file or on error. */
+int
+fgetc (FILE *f)
+{
+  unsigned char c;
+
+  if (f->state == READING && f->pos < f->end)
+    return (unsigned char) *f->pos++;
+  return fread (&c, 1, 1, f) == 1 ? c : EOF;
+}
+
+/* Reads a line of at most SIZE - 1 characters, including the
+   new-line character if there is one, from F into S and
+   null-terminates it.  Returns S, or a null pointer if end of
+   file or an error came before any character was read. */
+char *
+fgets (char *s, int size, FILE *f)
+{
+  int i = 0;
+
+  if (size <= 0)
+    return NULL;
+  while (i < size - 1)
+    {
+      int c = fgetc (f);
+      if (c == EOF)
+        break;
+      s[i++] = c;
+      if (c == '\n')
+        break;
+    }
+  s[i] = '\0';
+  return i > 0 ? s : NULL;
+}
+
+/* Writes C, converted to an unsigned char, to F.  Returns the
+   character written, or EOF on error. */
+int
+fputc (int c_, FILE *f)
+{
+  unsigned char c = c_;
+
+  /* Fast path: room in the buffer and no flush needed. */
+  if (f->state == WRITING && f->pos < f->buf + f->size - 1
+      && !(f->mode == _IOLBF && c == '\n'))
+    {
+      *f->pos++ = c;
+      return c;
+    }
+  return fwrite (&c, 1, 1, f) == 1 ? c : EOF;
+}
+
+/* Writes string S, without its null terminator, to F.  Returns
+   0 if successful, EOF on error. */
+int
+fputs (const char *s, FILE *f)
+{
+  size_t len = strlen (s);
+  return fwrite (s, 1, len, f) == len ? 0 : EOF;
+}
+
+/* Auxiliary data for vfprintf_helper(). */
+struct vfprintf_aux
+  {
+    FILE *f;                    /* Stream to write to. */
+    int char_cnt;               /* Characters written so far. */
+  };
+
+/* Writes C to the stream in AUX. */
+static void
+vfprintf_helper (char c, void *aux_)
+{
+  struct vfprintf_aux *aux = aux_;
+  fputc (c, aux->f);
+  aux->char_cnt++;
+}
+
+/* Formats the printf() format specification FORMAT with
+   arguments given in ARGS and writes the output to F.  Returns
+   the number of characters written. */
+int
+vfprintf (FILE *f, const char *format, va_list args)
+{
+  struct vfprintf_aux aux;
+
+  aux.f = f;
+  aux.char_cnt = 0;
+  __vprintf (format, args, vfprintf_helper, &aux);
+  return aux.char_cnt;
+}
+
+/* Like printf(), but writes output to F. */
+int
+fprintf (FILE *f, const char *format, ...)
+{
+  va_list args;
+  int retval;
+
+  va_start (args, format);
+  retval = vfprintf (f, format, args);
+  va_end (args);
+
+  return retval;
+}
+
+/* Returns nonzero if F has reached end of file. */
+int
+feof (FILE *f)
+{
+  return f->eof;
+}
+
+/* Returns nonzero if a read or write on F has failed. */
+int
+ferror (FILE *f)
+{
+  return f->error;
+}
@@ -1,9 +1,10 @@
 #include <syscall.h>
+#include <stdio.h>
 #include "../syscall-nr.h"
 
-/* Invokes syscall NUMBER, passing no arguments, and returns the
-   return value as an `int'. */
-#define syscall0(NUMBER)                                        \
+/* Invokes syscall NUMBER through "int $0x30", passing no
+   arguments, and returns the return value as an `int'. */
+#define int_syscall0(NUMBER)                                        \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
@@ -14,9 +15,9 @@
           retval;                                               \
         })
 
-/* Invokes syscall NUMBER, passing argument ARG0, and returns the
-   return value as an `int'. */
-#define syscall1(NUMBER, ARG0)                                           \
+/* Invokes syscall NUMBER through "int $0x30", passing argument
+   ARG0, and returns the return value as an `int'. */
+#define int_syscall1(NUMBER, ARG0)                                           \
         ({                                                               \
           int retval;                                                    \
           asm volatile                                                   \
@@ -28,9 +29,9 @@
           retval;                                                        \
         })
 
-/* Invokes syscall NUMBER, passing arguments ARG0 and ARG1, and
-   returns the return value as an `int'. */
-#define syscall2(NUMBER, ARG0, ARG1)                            \
+/* Invokes syscall NUMBER through "int $0x30", passing arguments
+   ARG0 and ARG1, and returns the return value as an `int'. */
+#define int_syscall2(NUMBER, ARG0, ARG1)                            \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
@@ -44,9 +45,10 @@
           retval;                                               \
         })
 
-/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, and
-   ARG2, and returns the return value as an `int'. */
-#define syscall3(NUMBER, ARG0, ARG1, ARG2)                      \
+/* Invokes syscall NUMBER through "int $0x30", passing arguments
+   ARG0, ARG1, and ARG2, and returns the return value as an
+   `int'. */
+#define int_syscall3(NUMBER, ARG0, ARG1, ARG2)                      \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
@@ -61,9 +63,67 @@
           retval;                                               \
         })
 
+/* Returns true if the CPU has the SYSENTER and SYSEXIT
+   instructions, asking it only the first time. */
+static bool
+use_sysenter (void)
+{
+  static int has_sep = -1;
+
+  if (has_sep < 0)
+    {
+      /* See [IA32-v2a] "CPUID".  Bit 11 of EDX is SEP. */
+      uint32_t eax = 1, ebx, ecx = 0, edx;
+      asm volatile ("cpuid"
+                    : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+      has_sep = (edx & (1 << 11)) != 0;
+    }
+  return has_sep;
+}
+
+/* Invokes syscall NUMBER through SYSENTER, passing ARG0, ARG1,
+   and ARG2 in EBX, ESI, and EDI, and returns the return value
+   as an `int'.  The kernel returns with SYSEXIT to the address
+   we leave in EDX, on the stack we leave in ECX, so both are
+   lost. */
+static inline int
+fast_syscall (int number, uint32_t arg0, uint32_t arg1, uint32_t arg2)
+{
+  int retval;
+  asm volatile
+    ("movl %%esp, %%ecx; leal 1f, %%edx; sysenter; 1:"
+       : "=a" (retval)
+       : "0" (number), "b" (arg0), "S" (arg1), "D" (arg2)
+       : "ecx", "edx", "memory", "cc");
+  return retval;
+}
+
+/* Invokes syscall NUMBER, passing up to three arguments, through
+   SYSENTER if the CPU has it or "int $0x30" if not, and returns
+   the return value as an `int'. */
+#define syscall0(NUMBER)                                        \
+        (use_sysenter ()                                        \
+         ? fast_syscall (NUMBER, 0, 0, 0)                       \
+         : int_syscall0 (NUMBER))
+#define syscall1(NUMBER, ARG0)                                  \
+        (use_sysenter ()                                        \
+         ? fast_syscall (NUMBER, (uint32_t) (ARG0), 0, 0)       \
+         : int_syscall1 (NUMBER, ARG0))
+#define syscall2(NUMBER, ARG0, ARG1)                            \
+        (use_sysenter ()                                        \
+         ? fast_syscall (NUMBER, (uint32_t) (ARG0),             \
+                         (uint32_t) (ARG1), 0)                  \
+         : int_syscall2 (NUMBER, ARG0, ARG1))
+#define syscall3(NUMBER, ARG0, ARG1, ARG2)                      \
+        (use_sysenter ()                                        \
+         ? fast_syscall (NUMBER, (uint32_t) (ARG0),             \
+                         (uint32_t) (ARG1), (uint32_t) (ARG2))  \
+         : int_syscall3 (NUMBER, ARG0, ARG1, ARG2))
+
 void
 halt (void) 
 {
+  fflush (NULL);
   syscall0 (SYS_HALT);
   NOT_REACHED ();
 }
@@ -71,6 +131,7 @@ halt (void)
 void
 exit (int status)
 {
+  fflush (NULL);
   syscall1 (SYS_EXIT, status);
   NOT_REACHED ();
 }
@@ -183,6 +244,36 @@ inumber (int fd)
   return syscall1 (SYS_INUMBER, fd);
 }
 
+void *
+sbrk (intptr_t increment)
+{
+  return (void *) syscall1 (SYS_SBRK, increment);
+}
+
+pid_t
+fork (void)
+{
+  return syscall0 (SYS_FORK);
+}
+
+void
+yield (void)
+{
+  syscall0 (SYS_YIELD);
+}
+
+pid_t
+getpid (void)
+{
+  return syscall0 (SYS_GETPID);
+}
+
+int
+ring_enter (struct syscall_ring *ring, unsigned count)
+{
+  return syscall2 (SYS_RING_ENTER, ring, count);
+}
+
 
 
 
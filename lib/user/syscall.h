@@ -2,6 +2,7 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <debug.h>
 
 /* Process identifier. */
@@ -45,4 +46,12 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+void *sbrk (intptr_t increment);
+pid_t fork (void);
+void yield (void);
+pid_t getpid (void);
+struct syscall_ring;
+int ring_enter (struct syscall_ring *, unsigned count);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,94 @@
+/* Measures how long a switch between two kernel threads takes,
+   first when the threads take turns with thread_yield(), then
+   when they hand a pair of semaphores back and forth, which adds
+   blocking and waking up to each switch.  The results are in CPU
+   cycles, as counted by the time-stamp counter, so they vary
+   from machine to machine; the test only checks that they are
+   reported. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Round trips timed per method. */
+#define ROUND_CNT 10000
+
+struct ping_pong
+  {
+    struct semaphore ping;      /* Upped by the main thread. */
+    struct semaphore pong;      /* Upped by the partner. */
+    struct semaphore done;      /* Upped when the partner exits. */
+  };
+
+static thread_func yield_partner;
+static thread_func sema_partner;
+
+void
+test_switch_latency (void) 
+{
+  struct ping_pong pp;
+  uint64_t start, cycles;
+  int i;
+
+  /* This test does not work with the MLFQS, which may not give
+     the two threads equal priority. */
+  ASSERT (!thread_mlfqs);
+
+  if ((cpu_features () & CPUID_TSC) == 0)
+    fail ("no time-stamp counter to measure with");
+
+  sema_init (&pp.ping, 0);
+  sema_init (&pp.pong, 0);
+  sema_init (&pp.done, 0);
+
+  /* Each yield switches to the other thread, which is the only
+     one ready. */
+  thread_create ("yield", thread_get_priority (), yield_partner, &pp);
+  start = rdtsc ();
+  for (i = 0; i < ROUND_CNT; i++)
+    thread_yield ();
+  cycles = rdtsc () - start;
+  sema_down (&pp.done);
+  msg ("yield: %llu cycles per switch", cycles / (2 * ROUND_CNT));
+
+  /* Each round trip blocks and wakes each thread once. */
+  thread_create ("sema", thread_get_priority (), sema_partner, &pp);
+  start = rdtsc ();
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      sema_up (&pp.ping);
+      sema_down (&pp.pong);
+    }
+  cycles = rdtsc () - start;
+  sema_down (&pp.done);
+  msg ("semaphore: %llu cycles per switch", cycles / (2 * ROUND_CNT));
+}
+
+static void
+yield_partner (void *pp_) 
+{
+  struct ping_pong *pp = pp_;
+  int i;
+
+  for (i = 0; i < ROUND_CNT; i++)
+    thread_yield ();
+  sema_up (&pp->done);
+}
+
+static void
+sema_partner (void *pp_) 
+{
+  struct ping_pong *pp = pp_;
+  int i;
+
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      sema_down (&pp->ping);
+      sema_up (&pp->pong);
+    }
+  sema_up (&pp->done);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The cycle counts depend on the machine, so only check that both
+# were reported, in order.
+my ($expected) = join ("\n",
+		       "(switch-latency) begin",
+		       "(switch-latency) yield: N cycles per switch",
+		       "(switch-latency) semaphore: N cycles per switch",
+		       "(switch-latency) end");
+my ($actual) = join ("\n", @output);
+$actual =~ s/: \d+ cycles/: N cycles/g;
+fail "Unexpected output:\n$actual\n" if $actual ne $expected;
+pass;
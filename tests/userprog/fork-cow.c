@@ -0,0 +1,51 @@
+/* Checks that a forked child and its parent share no memory:
+   writes either one makes after the fork, to data, bss, or
+   stack, are not seen by the other.  The child waits for the
+   parent's writes by polling for a file the parent creates once
+   it has made them. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char data[4096] = "before fork";
+static int bss;
+
+void
+test_main (void) 
+{
+  volatile int stack = 1;
+  pid_t pid;
+  int status;
+
+  bss = 1;
+  pid = fork ();
+  if (pid == 0)
+    {
+      while (open ("parent-wrote") < 0)
+        yield ();
+      if (strcmp (data, "before fork") || bss != 1 || stack != 1)
+        fail ("child: sees the parent's writes");
+      msg ("child: parent's writes are not visible");
+
+      strlcpy (data, "child", sizeof data);
+      bss = 2;
+      stack = 2;
+      exit (81);
+    }
+  if (pid < 0)
+    fail ("fork() returned %d", pid);
+
+  strlcpy (data, "parent", sizeof data);
+  bss = 3;
+  stack = 3;
+  if (!create ("parent-wrote", 0))
+    fail ("create \"parent-wrote\"");
+
+  status = wait (pid);
+  CHECK (status == 81, "parent: wait(fork()) = 81");
+  if (strcmp (data, "parent") || bss != 3 || stack != 3)
+    fail ("parent: sees the child's writes");
+  msg ("parent: child's writes are not visible");
+}
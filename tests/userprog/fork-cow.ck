@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-cow) begin
+(fork-cow) child: parent's writes are not visible
+fork-cow: exit(81)
+(fork-cow) parent: wait(fork()) = 81
+(fork-cow) parent: child's writes are not visible
+(fork-cow) end
+fork-cow: exit(0)
+EOF
+pass;
@@ -0,0 +1,43 @@
+/* Opens a file, reads part of it, and forks.  The child must
+   start at the parent's position, and its reads and seeks must
+   not move the parent's. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[10];
+  int handle;
+  pid_t pid;
+  int status;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (handle, buf, sizeof buf) == sizeof buf, "read 10 bytes");
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      if (tell (handle) != 10)
+        fail ("child: position is %u, not 10", tell (handle));
+      if (read (handle, buf, sizeof buf) != sizeof buf
+          || memcmp (buf, sample + 10, sizeof buf))
+        fail ("child: bytes 10 to 20 read back wrong");
+      seek (handle, 50);
+      msg ("child: read bytes 10 to 20, then seeked to 50");
+      exit (81);
+    }
+  if (pid < 0)
+    fail ("fork() returned %d", pid);
+
+  status = wait (pid);
+  CHECK (status == 81, "wait(fork()) = 81");
+  CHECK (tell (handle) == 10, "parent: position is still 10");
+  CHECK (read (handle, buf, sizeof buf) == sizeof buf
+         && !memcmp (buf, sample + 10, sizeof buf),
+         "parent: read bytes 10 to 20");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-fd) begin
+(fork-fd) open "sample.txt"
+(fork-fd) read 10 bytes
+(fork-fd) child: read bytes 10 to 20, then seeked to 50
+fork-fd: exit(81)
+(fork-fd) wait(fork()) = 81
+(fork-fd) parent: position is still 10
+(fork-fd) parent: read bytes 10 to 20
+(fork-fd) end
+fork-fd: exit(0)
+EOF
+pass;
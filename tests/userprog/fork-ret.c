@@ -0,0 +1,26 @@
+/* Forks a child.  The child must see fork() return 0, and the
+   parent must see the child's pid, which the child hands back
+   as its exit status. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  pid_t pid;
+  int status;
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      msg ("child: fork() returned 0");
+      exit (getpid ());
+    }
+  if (pid < 0)
+    fail ("fork() returned %d", pid);
+
+  status = wait (pid);
+  CHECK (status == pid, "parent: wait(fork()) = child's pid");
+}
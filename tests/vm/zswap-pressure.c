@@ -0,0 +1,87 @@
+/* Fills 1 MB of memory, several times the user pool the test
+   runs with, so that its pages are evicted to the compressed swap
+   cache and from there to disk, and checks that every page reads
+   back intact.  Then forks: the child checks the pages it shares
+   with its parent, overwrites some of them, and exits, and the
+   parent checks that its own copy is untouched. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 256
+
+static char buf[PAGE_CNT][PAGE_SIZE];
+
+/* Fills PAGE with what page PAGE_NO of BUF should hold.  Even
+   pages compress well, odd pages are random and do not. */
+static void
+fill_page (char *page, size_t page_no)
+{
+  if (page_no % 2 == 0)
+    {
+      size_t i;
+
+      for (i = 0; i < PAGE_SIZE; i++)
+        page[i] = page_no + i / 64;
+    }
+  else
+    {
+      struct arc4 arc4;
+
+      arc4_init (&arc4, &page_no, sizeof page_no);
+      memset (page, 0, PAGE_SIZE);
+      arc4_crypt (&arc4, page, PAGE_SIZE);
+    }
+}
+
+/* Fails unless every page of BUF holds what fill_page() put
+   there. */
+static void
+check_pages (void)
+{
+  static char expected[PAGE_SIZE];
+  size_t i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      fill_page (expected, i);
+      if (memcmp (buf[i], expected, PAGE_SIZE))
+        fail ("page %zu has wrong contents", i);
+    }
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+  int status;
+  size_t i;
+
+  msg ("fill");
+  for (i = 0; i < PAGE_CNT; i++)
+    fill_page (buf[i], i);
+
+  msg ("check");
+  check_pages ();
+
+  child = fork ();
+  if (child == 0)
+    {
+      msg ("child check");
+      check_pages ();
+      for (i = 0; i < PAGE_CNT; i += 3)
+        memset (buf[i], 0xcc, PAGE_SIZE);
+      exit (81);
+    }
+  if (child < 0)
+    fail ("fork failed");
+  status = wait (child);
+  CHECK (status == 81, "wait for child");
+
+  msg ("parent check");
+  check_pages ();
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(zswap-pressure) begin
+(zswap-pressure) fill
+(zswap-pressure) check
+(zswap-pressure) child check
+(zswap-pressure) wait for child
+(zswap-pressure) parent check
+(zswap-pressure) end
+EOF
+pass;
@@ -0,0 +1,64 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdint.h>
+
+/* Feature flags reported in EDX by CPUID leaf 1.
+   See [IA32-v2a] "CPUID--CPU Identification". */
+#define CPUID_PSE (1 << 3)      /* 4 MB pages. */
+#define CPUID_TSC (1 << 4)      /* Time-stamp counter. */
+#define CPUID_SEP (1 << 11)     /* SYSENTER and SYSEXIT. */
+#define CPUID_PGE (1 << 13)     /* Global pages. */
+
+/* Control register 4 flags.  See [IA32-v3a] 2.5 "Control
+   Registers". */
+#define CR4_PSE 0x00000010      /* Page Size Extensions. */
+#define CR4_PGE 0x00000080      /* Page Global Enable. */
+
+/* Returns the feature flags of CPUID leaf 1, a combination of
+   the CPUID_* flags above among others. */
+static inline uint32_t
+cpu_features (void)
+{
+  /* See [IA32-v2a] "CPUID". */
+  uint32_t eax = 1, ebx, ecx = 0, edx;
+  asm volatile ("cpuid"
+                : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+  return edx;
+}
+
+/* Returns the contents of control register 4. */
+static inline uint32_t
+read_cr4 (void)
+{
+  uint32_t cr4;
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  return cr4;
+}
+
+/* Stores CR4 into control register 4. */
+static inline void
+write_cr4 (uint32_t cr4)
+{
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4) : "memory");
+}
+
+/* Writes VALUE to model-specific register MSR.
+   See [IA32-v2b] "WRMSR". */
+static inline void
+wrmsr (uint32_t msr, uint64_t value)
+{
+  asm volatile ("wrmsr" : : "c" (msr), "A" (value));
+}
+
+/* Returns the time-stamp counter, which counts processor clock
+   cycles.  See [IA32-v2b] "RDTSC". */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+#endif /* threads/cpu.h */
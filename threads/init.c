@@ -5,6 +5,7 @@
 #include <limits.h>
 #include <random.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,6 +16,7 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -25,6 +27,7 @@
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
+#include "userprog/frame.h"
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
@@ -34,9 +37,13 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "devices/ramdisk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/zswap.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
@@ -54,6 +61,9 @@ static const char *swap_bdev_name;
 #endif
 #endif /* FILESYS */
 
+/* -small-pages: Map kernel memory with 4 kB pages only? */
+static bool small_pages;
+
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
@@ -112,11 +122,14 @@ main (void)
   input_init ();
 #ifdef USERPROG
   exception_init ();
+  frame_init ();
   syscall_init ();
+  process_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  palloc_start_zeroing ();
   serial_init_queue ();
   timer_calibrate ();
 
@@ -127,6 +140,11 @@ main (void)
   filesys_init (format_filesys);
 #endif
 
+#ifdef VM
+  /* Initialize the swap cache, which needs the swap device. */
+  zswap_init ();
+#endif
+
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -153,13 +171,29 @@ bss_init (void)
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports them, every 4 MB of RAM that holds no
+   kernel text is mapped with a single large page, and all of the
+   mapping is global, so that kernel TLB entries survive the CR3
+   reloads of process switches.  Kernel text stays read-only
+   through 4 kB pages. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  uint32_t global = 0;
+  bool large_pages = false;
+
+  if (!small_pages
+      && (cpu_features () & (CPUID_PSE | CPUID_PGE)) == (CPUID_PSE | CPUID_PGE))
+    {
+      write_cr4 (read_cr4 () | CR4_PSE | CR4_PGE);
+      global = PTE_G;
+      large_pages = true;
+    }
 
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
@@ -173,11 +207,21 @@ paging_init (void)
 
       if (pd[pde_idx] == 0)
         {
+          size_t large_cnt = PTSPAN / PGSIZE;
+
+          if (large_pages && pte_idx == 0
+              && page + large_cnt <= init_ram_pages
+              && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+            {
+              pd[pde_idx] = pde_create_kernel_large (vaddr, true);
+              page += large_cnt - 1;
+              continue;
+            }
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
           pd[pde_idx] = pde_create (pt);
         }
 
-      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
+      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text) | global;
     }
 
   /* Store the physical address of the page directory into CR3
@@ -256,9 +300,31 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-mstats"))
+        malloc_stats_detail = true;
+      else if (!strcmp (name, "-small-pages"))
+        small_pages = true;
+      else if (!strcmp (name, "-periodic"))
+        timer_periodic = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-fault-around"))
+        fault_around_pages = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-zswap"))
+        {
+          /* atoi() would take "-1" or "lots" without complaint, and
+             the budget is a size_t. */
+          if (value == NULL || *value == '\0'
+              || value[strspn (value, "0123456789")] != '\0'
+              || strlen (value) > 7
+              || (size_t) atoi (value) > SIZE_MAX / 1024)
+            PANIC ("bad -zswap value `%s' (use -h for help)",
+                   value != NULL ? value : "");
+          zswap_budget_kb = atoi (value);
+        }
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -376,11 +442,21 @@ usage (void)
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
+          "                     BDEV may be ramdisk:SIZE (e.g. ramdisk:4M)\n"
+          "                     for a device backed by kernel memory.\n"
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -mstats            Dump per-size heap statistics at shutdown.\n"
+          "  -small-pages       Map kernel memory without 4 MB global pages.\n"
+          "  -periodic          Keep the timer ticking while idle.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -fault-around=N    Map up to N text pages per page fault.\n"
+#endif
+#ifdef VM
+          "  -zswap=KB          Keep up to KB kB of swapped pages compressed\n"
+          "                     in memory before writing them to disk.\n"
 #endif
           );
   shutdown_power_off ();
@@ -401,13 +477,22 @@ locate_block_devices (void)
 /* Figures out what block device to use for the given ROLE: the
    block device with the given NAME, if NAME is non-null,
    otherwise the first block device in probe order of type
-   ROLE. */
+   ROLE.  A NAME of the form "ramdisk:SIZE", e.g. "ramdisk:4M",
+   creates a new memory-backed device of SIZE bytes instead. */
 static void
 locate_block_device (enum block_type role, const char *name)
 {
   struct block *block = NULL;
 
-  if (name != NULL)
+  if (name != NULL && strnlen (name, 8) == 8
+      && !memcmp (name, "ramdisk:", 8))
+    {
+      size_t size;
+      if (!ramdisk_parse_size (name + 8, &size))
+        PANIC ("Bad ramdisk size in \"%s\"", name);
+      block = ramdisk_create (role, size);
+    }
+  else if (name != NULL)
     {
       block = block_get_by_name (name);
       if (block == NULL)
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -32,7 +33,22 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   Each descriptor counts its allocations, frees, arenas, and the
+   peak number of blocks in use at once, and big blocks are
+   counted the same way, for malloc_print_stats().  In kernels
+   built with MALLOC_TRACK defined, every block also carries a
+   header naming the source location that allocated it and is
+   kept on a list of live blocks, so that leaks can be traced to
+   their allocation sites. */
+
+/* malloc.h redirects these to their _tagged versions in
+   MALLOC_TRACK builds.  The functions themselves are defined
+   here under their own names. */
+#undef malloc
+#undef calloc
+#undef realloc
 
 /* Descriptor. */
 struct desc
@@ -41,8 +57,38 @@ struct desc
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+
+    /* Statistics. */
+    unsigned long long allocs;  /* Number of blocks allocated. */
+    unsigned long long frees;   /* Number of blocks freed. */
+    size_t peak;                /* Most blocks in use at once. */
+    size_t arena_cnt;           /* Number of arenas. */
   };
 
+/* Big block statistics, protected by big_lock. */
+static struct lock big_lock;
+static unsigned long long big_allocs;   /* Big blocks allocated. */
+static unsigned long long big_frees;    /* Big blocks freed. */
+static size_t big_pages;                /* Pages in live big blocks. */
+static size_t big_peak;                 /* Most big block pages at once. */
+
+#ifdef MALLOC_TRACK
+/* Header in front of every block in MALLOC_TRACK builds. */
+struct tag
+  {
+    struct list_elem elem;      /* Element in live_blocks. */
+    const char *site;           /* Allocation site, or null. */
+    size_t size;                /* Size requested by caller. */
+  };
+
+/* Every allocated block, protected by live_lock. */
+static struct list live_blocks;
+static struct lock live_lock;
+#endif
+
+/* See malloc.h. */
+bool malloc_stats_detail;
+
 /* Magic number for detecting arena corruption. */
 #define ARENA_MAGIC 0x9a548eed
 
@@ -66,6 +112,12 @@ static size_t desc_cnt;         /* Number of descriptors. */
 
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void *alloc_block (size_t size);
+static void free_block (void *);
+static void *do_malloc (size_t size, const char *site);
+static void *do_calloc (size_t a, size_t b, const char *site);
+static void *do_realloc (void *, size_t new_size, const char *site);
+static void do_free (void *);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -82,12 +134,189 @@ malloc_init (void)
       list_init (&d->free_list);
       lock_init (&d->lock);
     }
+  lock_init (&big_lock);
+#ifdef MALLOC_TRACK
+  list_init (&live_blocks);
+  lock_init (&live_lock);
+#endif
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) 
+{
+  return do_malloc (size, NULL);
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b) 
+{
+  return do_calloc (a, b, NULL);
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size) 
+{
+  return do_realloc (old_block, new_size, NULL);
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p) 
+{
+  do_free (p);
+}
+
+#ifdef MALLOC_TRACK
+/* Like malloc(), but records SITE as the block's allocation
+   site. */
+void *
+malloc_tagged (size_t size, const char *site)
+{
+  return do_malloc (size, site);
+}
+
+/* Like calloc(), but records SITE as the block's allocation
+   site. */
+void *
+calloc_tagged (size_t a, size_t b, const char *site)
+{
+  return do_calloc (a, b, site);
+}
+
+/* Like realloc(), but records SITE as the new block's
+   allocation site. */
+void *
+realloc_tagged (void *old_block, size_t new_size, const char *site)
+{
+  return do_realloc (old_block, new_size, site);
+}
+#endif
+
+/* Prints heap usage: a summary line, and with
+   malloc_stats_detail set, each descriptor's counters and, in
+   MALLOC_TRACK builds, the site and size of every live block.
+
+   This runs at power off, which a kernel panic reaches with
+   interrupts off and perhaps with a malloc lock held, so the
+   counters are snapshotted with interrupts off instead of under
+   the locks, and the live blocks are only listed when interrupts
+   are on, that is, on a normal shutdown. */
+void
+malloc_print_stats (void)
+{
+  struct desc snap[sizeof descs / sizeof *descs];
+  unsigned long long allocs, frees;
+  size_t pages, peak;
+  size_t blocks = 0, bytes = 0, arenas = 0;
+  enum intr_level old_level;
+  size_t i;
+
+  old_level = intr_disable ();
+  memcpy (snap, descs, sizeof snap);
+  allocs = big_allocs;
+  frees = big_frees;
+  pages = big_pages;
+  peak = big_peak;
+  intr_set_level (old_level);
+
+  for (i = 0; i < desc_cnt; i++)
+    {
+      struct desc *d = &snap[i];
+      size_t live = d->allocs - d->frees;
+
+      blocks += live;
+      bytes += live * d->block_size;
+      arenas += d->arena_cnt;
+      if (malloc_stats_detail)
+        printf ("Malloc %4zu-byte blocks: %llu allocs, %llu frees, "
+                "%zu live, %zu peak, %zu arenas\n",
+                d->block_size, d->allocs, d->frees, live, d->peak,
+                d->arena_cnt);
+    }
+
+  if (malloc_stats_detail)
+    printf ("Malloc big blocks: %llu allocs, %llu frees, %zu pages live, "
+            "%zu peak\n", allocs, frees, pages, peak);
+  printf ("Malloc: %zu blocks (%zu bytes) live in %zu arenas, "
+          "%llu big blocks (%zu pages) live\n", blocks, bytes, arenas,
+          allocs - frees, pages);
+
+#ifdef MALLOC_TRACK
+  if (malloc_stats_detail && !intr_context ()
+      && intr_get_level () == INTR_ON)
+    {
+      struct list_elem *e;
+
+      lock_acquire (&live_lock);
+      for (e = list_begin (&live_blocks); e != list_end (&live_blocks);
+           e = list_next (e))
+        {
+          struct tag *t = list_entry (e, struct tag, elem);
+          printf ("Malloc live block: %zu bytes from %s\n",
+                  t->size, t->site != NULL ? t->site : "unknown site");
+        }
+      lock_release (&live_lock);
+    }
+#endif
+}
+
+/* Allocates a block of SIZE bytes for a caller at SITE, which
+   is only recorded in MALLOC_TRACK builds. */
+static void *
+do_malloc (size_t size, const char *site UNUSED)
+{
+#ifdef MALLOC_TRACK
+  struct tag *t;
+
+  if (size == 0)
+    return NULL;
+  t = alloc_block (size + sizeof *t);
+  if (t == NULL)
+    return NULL;
+  t->site = site;
+  t->size = size;
+  lock_acquire (&live_lock);
+  list_push_back (&live_blocks, &t->elem);
+  lock_release (&live_lock);
+  return t + 1;
+#else
+  return alloc_block (size);
+#endif
+}
+
+/* Frees block P allocated by do_malloc(). */
+static void
+do_free (void *p)
+{
+#ifdef MALLOC_TRACK
+  if (p != NULL)
+    {
+      struct tag *t = (struct tag *) p - 1;
+      lock_acquire (&live_lock);
+      list_remove (&t->elem);
+      lock_release (&live_lock);
+      p = t;
+    }
+#endif
+  free_block (p);
+}
+
+/* Obtains and returns a new block of at least SIZE bytes from
+   the descriptors or, for large SIZE, the page allocator.
+   Returns a null pointer if memory is not available. */
+static void *
+alloc_block (size_t size) 
 {
   struct desc *d;
   struct block *b;
@@ -116,6 +345,13 @@ malloc (size_t size)
       a->magic = ARENA_MAGIC;
       a->desc = NULL;
       a->free_cnt = page_cnt;
+
+      lock_acquire (&big_lock);
+      big_allocs++;
+      big_pages += page_cnt;
+      if (big_pages > big_peak)
+        big_peak = big_pages;
+      lock_release (&big_lock);
       return a + 1;
     }
 
@@ -143,20 +379,25 @@ malloc (size_t size)
           struct block *b = arena_to_block (a, i);
           list_push_back (&d->free_list, &b->free_elem);
         }
+      d->arena_cnt++;
     }
 
   /* Get a block from free list and return it. */
   b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
   a = block_to_arena (b);
   a->free_cnt--;
+  d->allocs++;
+  if (d->allocs - d->frees > d->peak)
+    d->peak = d->allocs - d->frees;
   lock_release (&d->lock);
   return b;
 }
 
-/* Allocates and return A times B bytes initialized to zeroes.
-   Returns a null pointer if memory is not available. */
-void *
-calloc (size_t a, size_t b) 
+/* Allocates and return A times B bytes initialized to zeroes,
+   for a caller at SITE.  Returns a null pointer if memory is not
+   available. */
+static void *
+do_calloc (size_t a, size_t b, const char *site)
 {
   void *p;
   size_t size;
@@ -167,56 +408,58 @@ calloc (size_t a, size_t b)
     return NULL;
 
   /* Allocate and zero memory. */
-  p = malloc (size);
+  p = do_malloc (size, site);
   if (p != NULL)
     memset (p, 0, size);
 
   return p;
 }
 
-/* Returns the number of bytes allocated for BLOCK. */
+/* Returns the number of bytes allocated for BLOCK, a block
+   returned by do_malloc(). */
 static size_t
 block_size (void *block) 
 {
+#ifdef MALLOC_TRACK
+  return ((struct tag *) block - 1)->size;
+#else
   struct block *b = block;
   struct arena *a = block_to_arena (b);
   struct desc *d = a->desc;
 
   return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
+#endif
 }
 
-/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
-   moving it in the process.
-   If successful, returns the new block; on failure, returns a
-   null pointer.
-   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
-   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
-void *
-realloc (void *old_block, size_t new_size) 
+/* Resizes OLD_BLOCK to NEW_SIZE bytes as described for
+   realloc(), recording SITE as the new block's allocation
+   site. */
+static void *
+do_realloc (void *old_block, size_t new_size, const char *site)
 {
   if (new_size == 0) 
     {
-      free (old_block);
+      do_free (old_block);
       return NULL;
     }
   else 
     {
-      void *new_block = malloc (new_size);
+      void *new_block = do_malloc (new_size, site);
       if (old_block != NULL && new_block != NULL)
         {
           size_t old_size = block_size (old_block);
           size_t min_size = new_size < old_size ? new_size : old_size;
           memcpy (new_block, old_block, min_size);
-          free (old_block);
+          do_free (old_block);
         }
       return new_block;
     }
 }
 
 /* Frees block P, which must have been previously allocated with
-   malloc(), calloc(), or realloc(). */
-void
-free (void *p) 
+   alloc_block(). */
+static void
+free_block (void *p) 
 {
   if (p != NULL)
     {
@@ -237,6 +480,7 @@ free (void *p)
 
           /* Add block to free list. */
           list_push_front (&d->free_list, &b->free_elem);
+          d->frees++;
 
           /* If the arena is now entirely unused, free it. */
           if (++a->free_cnt >= d->blocks_per_arena) 
@@ -250,6 +494,7 @@ free (void *p)
                   list_remove (&b->free_elem);
                 }
               palloc_free_page (a);
+              d->arena_cnt--;
             }
 
           lock_release (&d->lock);
@@ -257,6 +502,10 @@ free (void *p)
       else
         {
           /* It's a big block.  Free its pages. */
+          lock_acquire (&big_lock);
+          big_frees++;
+          big_pages -= a->free_cnt;
+          lock_release (&big_lock);
           palloc_free_multiple (a, a->free_cnt);
           return;
         }
@@ -2,12 +2,36 @@
 #define THREADS_MALLOC_H
 
 #include <debug.h>
+#include <stdbool.h>
 #include <stddef.h>
 
+/* If true, malloc_print_stats() prints every descriptor's
+   counters and, in MALLOC_TRACK builds, every live block.
+   Controlled by the kernel command-line option "-mstats". */
+extern bool malloc_stats_detail;
+
 void malloc_init (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
+void malloc_print_stats (void);
+
+/* Leak tracking.  Building with -DMALLOC_TRACK gives each block a
+   small header recording the source location that allocated it,
+   so that malloc_print_stats() can list blocks never freed. */
+#ifdef MALLOC_TRACK
+void *malloc_tagged (size_t, const char *site) __attribute__ ((malloc));
+void *calloc_tagged (size_t, size_t, const char *site)
+  __attribute__ ((malloc));
+void *realloc_tagged (void *, size_t, const char *site);
+
+#define MALLOC_STR(X) #X
+#define MALLOC_XSTR(X) MALLOC_STR (X)
+#define MALLOC_SITE __FILE__ ":" MALLOC_XSTR (__LINE__)
+#define malloc(SIZE) malloc_tagged (SIZE, MALLOC_SITE)
+#define calloc(A, B) calloc_tagged (A, B, MALLOC_SITE)
+#define realloc(BLOCK, SIZE) realloc_tagged (BLOCK, SIZE, MALLOC_SITE)
+#endif
 
 #endif /* threads/malloc.h */
@@ -1,14 +1,16 @@
 #include "threads/palloc.h"
-#include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,22 +25,85 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Within a pool, pages are managed by a binary buddy allocator.
+   Free memory is kept as blocks of 2**ORDER pages, each aligned
+   to its own size relative to the pool base, on one free list
+   per order.  An allocation takes the smallest block that is big
+   enough, splitting larger blocks in half as needed, and returns
+   any pages beyond the requested count to the free lists.  A
+   freed block is merged with its "buddy", the other half of the
+   block it was split from, whenever that buddy is also free.
+   Free blocks link into their free list through a list_elem at
+   the start of their first page.
+
+   A pool is protected by turning interrupts off rather than by a
+   lock, because thread_schedule_tail() frees a dying thread's
+   page in the middle of a context switch, where blocking is not
+   an option.  Every critical section is a few list operations,
+   so interrupts are never off for long.
+
+   Each pool also keeps a stock of pages that have already been
+   filled with zeros, so that a single-page PAL_ZERO allocation
+   is just a list pop.  The "pagezero" thread refills the stocks
+   in the background whenever they run low.  Stocked pages are
+   allocated as far as the buddy allocator is concerned; each
+   one's first bytes hold the list_elem that links it into the
+   stock, and are cleared again as it is handed out. */
+
+/* Most pre-zeroed pages kept in stock per pool.  Smaller pools
+   keep at most 1/ZERO_STOCK_DIV of their pages in stock. */
+#define ZERO_STOCK_MAX 64
+#define ZERO_STOCK_DIV 16
+
+/* Largest block order.  Blocks of up to 2**MAX_ORDER pages are
+   tracked, which is more than any pool can hold. */
+#define MAX_ORDER 20
+
+/* order_map value for a page that does not begin a free block. */
+#define NOT_FREE UINT8_MAX
+
+/* Returned by buddy_alloc() on failure. */
+#define BUDDY_ERROR SIZE_MAX
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
-    struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+    size_t page_cnt;                    /* Number of pages in pool. */
+    const char *name;                   /* Name, for statistics. */
+
+    /* Buddy allocator. */
+    uint8_t *order_map;                 /* Order of free block at page. */
+    struct list free_list[MAX_ORDER + 1]; /* Free blocks by order. */
+    size_t free_cnt[MAX_ORDER + 1];     /* Length of each free list. */
+    size_t free_pages;                  /* Total pages in free blocks. */
+
+    /* Pre-zeroed pages. */
+    struct list zeroed;                 /* Stock of zeroed pages. */
+    size_t zeroed_cnt;                  /* Number of pages in stock. */
+    size_t zeroed_max;                  /* Target stock size. */
+    bool refill_wanted;                 /* Has pagezero been woken? */
+    unsigned long long zero_hits;       /* PAL_ZERO pages from stock. */
+    unsigned long long zero_misses;     /* PAL_ZERO pages zeroed inline. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Upped when a pool's stock of zeroed pages runs low. */
+static struct semaphore refill_sema;
+
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void *take_zeroed (struct pool *);
+static void release_zeroed (struct pool *);
+static bool refill_zeroed (struct pool *);
+static thread_func pagezero;
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -59,6 +124,16 @@ palloc_init (size_t user_page_limit)
   init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
   init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
              user_pages, "user pool");
+  sema_init (&refill_sema, 0);
+}
+
+/* Starts the thread that keeps the pools stocked with zeroed
+   pages.  Must be called after thread_start(). */
+void
+palloc_start_zeroing (void)
+{
+  kernel_pool.refill_wanted = user_pool.refill_wanted = true;
+  thread_create ("pagezero", PRI_MIN, pagezero, NULL);
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
@@ -71,17 +146,42 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
   void *pages;
   size_t page_idx;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  old_level = intr_disable ();
+  if (page_cnt == 1 && (flags & PAL_ZERO) && pool->zeroed_cnt > 0)
+    {
+      pages = take_zeroed (pool);
+      pool->zero_hits++;
+      intr_set_level (old_level);
+      return pages;
+    }
 
-  if (page_idx != BITMAP_ERROR)
+  page_idx = buddy_alloc (pool, page_cnt);
+  if (page_idx == BUDDY_ERROR && pool->zeroed_cnt > 0)
+    {
+      /* Out of free pages: fall back on the stock.  A single page
+         can come straight from it; a larger run needs the stock
+         returned to the free lists first. */
+      if (page_cnt == 1)
+        {
+          pages = take_zeroed (pool);
+          intr_set_level (old_level);
+          return pages;
+        }
+      release_zeroed (pool);
+      page_idx = buddy_alloc (pool, page_cnt);
+    }
+  if (page_idx != BUDDY_ERROR && (flags & PAL_ZERO))
+    pool->zero_misses += page_cnt;
+  intr_set_level (old_level);
+
+  if (page_idx != BUDDY_ERROR)
     pages = pool->base + PGSIZE * page_idx;
   else
     pages = NULL;
@@ -118,6 +218,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
+  enum intr_level old_level;
   size_t page_idx;
 
   ASSERT (pg_ofs (pages) == 0);
@@ -137,8 +238,9 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  old_level = intr_disable ();
+  buddy_free (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,25 +250,88 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Prints free block and pre-zeroed page statistics for POOL.
+   Fragmentation is the share of free pages that lie outside the
+   largest free block, that is, that could not be handed out as
+   part of the biggest possible allocation. */
+static void
+print_pool_stats (struct pool *pool)
+{
+  size_t free_cnt[MAX_ORDER + 1];
+  size_t free_pages, largest = 0;
+  unsigned long long zero_hits, zero_misses;
+  enum intr_level old_level;
+  int order;
+
+  /* Take a consistent snapshot, then print it with interrupts
+     back on. */
+  old_level = intr_disable ();
+  memcpy (free_cnt, pool->free_cnt, sizeof free_cnt);
+  free_pages = pool->free_pages;
+  zero_hits = pool->zero_hits;
+  zero_misses = pool->zero_misses;
+  intr_set_level (old_level);
+
+  printf ("%s: %zu of %zu pages free in blocks of",
+          pool->name, free_pages, pool->page_cnt);
+  for (order = 0; order <= MAX_ORDER; order++)
+    if (free_cnt[order] > 0)
+      {
+        printf (" %zux%zu", free_cnt[order], (size_t) 1 << order);
+        largest = (size_t) 1 << order;
+      }
+  printf (", %zu%% fragmented\n",
+          free_pages > 0 ? (free_pages - largest) * 100 / free_pages : 0);
+  printf ("%s: %llu zeroed pages from stock, %llu zeroed on demand\n",
+          pool->name, zero_hits, zero_misses);
+}
+
+/* Prints statistics about the page allocator. */
+void
+palloc_print_stats (void)
+{
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  /* We'll put the pool's order_map, one byte per page, at its
+     base.  Calculate the space needed for the map and subtract
+     it from the pool's size. */
+  size_t map_pages = DIV_ROUND_UP (page_cnt, PGSIZE);
+  int order;
+
+  if (map_pages > page_cnt)
+    PANIC ("Not enough memory in %s for order map.", name);
+  page_cnt -= map_pages;
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  p->order_map = base;
+  p->base = base + map_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+  p->name = name;
+  memset (p->order_map, NOT_FREE, page_cnt);
+  for (order = 0; order <= MAX_ORDER; order++)
+    {
+      list_init (&p->free_list[order]);
+      p->free_cnt[order] = 0;
+    }
+  p->free_pages = 0;
+  buddy_free (p, 0, page_cnt);
+
+  list_init (&p->zeroed);
+  p->zeroed_cnt = 0;
+  p->zeroed_max = page_cnt / ZERO_STOCK_DIV;
+  if (p->zeroed_max > ZERO_STOCK_MAX)
+    p->zeroed_max = ZERO_STOCK_MAX;
+  p->refill_wanted = false;
+  p->zero_hits = p->zero_misses = 0;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -176,7 +341,238 @@ page_from_pool (const struct pool *pool, void *page)
 {
   size_t page_no = pg_no (page);
   size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the first page of the block at PAGE_IDX in POOL. */
+static inline struct list_elem *
+block_elem (struct pool *pool, size_t page_idx)
+{
+  return (struct list_elem *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Adds the free block of 2**ORDER pages at PAGE_IDX in POOL to
+   its free list, without merging it with its buddy. */
+static void
+add_block (struct pool *pool, size_t page_idx, int order)
+{
+  pool->order_map[page_idx] = order;
+  list_push_front (&pool->free_list[order], block_elem (pool, page_idx));
+  pool->free_cnt[order]++;
+  pool->free_pages += (size_t) 1 << order;
+}
+
+/* Removes the free block of 2**ORDER pages at PAGE_IDX in POOL
+   from its free list. */
+static void
+remove_block (struct pool *pool, size_t page_idx, int order)
+{
+  ASSERT (pool->order_map[page_idx] == order);
+
+  pool->order_map[page_idx] = NOT_FREE;
+  list_remove (block_elem (pool, page_idx));
+  pool->free_cnt[order]--;
+  pool->free_pages -= (size_t) 1 << order;
+}
+
+/* Frees the block of 2**ORDER pages at PAGE_IDX in POOL,
+   repeatedly merging it with its buddy while the buddy is free
+   in its entirety. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order)
+{
+  while (order < MAX_ORDER)
+    {
+      size_t buddy_idx = page_idx ^ ((size_t) 1 << order);
+      if (buddy_idx >= pool->page_cnt
+          || pool->order_map[buddy_idx] != order)
+        break;
+      remove_block (pool, buddy_idx, order);
+      if (buddy_idx < page_idx)
+        page_idx = buddy_idx;
+      order++;
+    }
+  add_block (pool, page_idx, order);
+}
+
+/* Returns true if the page at PAGE_IDX in POOL lies inside a
+   free block.  Free blocks are aligned to their own size, so the
+   only candidates are the block of each order that would contain
+   the page. */
+static bool
+page_is_free (const struct pool *pool, size_t page_idx)
+{
+  int order;
+
+  for (order = 0; order <= MAX_ORDER; order++)
+    {
+      size_t head = page_idx & ~(((size_t) 1 << order) - 1);
+      if (pool->order_map[head] == order)
+        return true;
+    }
+  return false;
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX in POOL, which need not
+   form a single block: the range is split into the largest
+   blocks that are aligned to their own size. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  size_t i;
+
+  ASSERT (page_idx + page_cnt <= pool->page_cnt);
+  for (i = page_idx; i < page_idx + page_cnt; i++)
+    ASSERT (!page_is_free (pool, i));
+
+  while (page_cnt > 0)
+    {
+      int order = 0;
+      while (order < MAX_ORDER
+             && (page_idx & ((size_t) 1 << order)) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BUDDY_ERROR if no free block is large
+   enough.  The request is served from a block of the smallest
+   order that holds PAGE_CNT pages, and the unused pages at its
+   end are freed again. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt)
+{
+  size_t page_idx;
+  int want, order;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (want = 0; ((size_t) 1 << want) < page_cnt; want++)
+    if (want == MAX_ORDER)
+      return BUDDY_ERROR;
+
+  for (order = want; order <= MAX_ORDER; order++)
+    if (!list_empty (&pool->free_list[order]))
+      break;
+  if (order > MAX_ORDER)
+    return BUDDY_ERROR;
+
+  page_idx = (pg_no (list_front (&pool->free_list[order]))
+              - pg_no (pool->base));
+  remove_block (pool, page_idx, order);
+
+  /* Split off and free the upper half until the block is the
+     size we want. */
+  while (order > want)
+    {
+      order--;
+      add_block (pool, page_idx + ((size_t) 1 << order), order);
+    }
+
+  if (((size_t) 1 << want) > page_cnt)
+    buddy_free (pool, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+  return page_idx;
+}
+
+/* Removes a page from POOL's stock of zeroed pages and returns
+   it with its list_elem wiped, so that it is entirely zero.
+   Wakes the zeroing thread if the stock has fallen to half of
+   its target.  Interrupts must be off and POOL's stock must not
+   be empty. */
+static void *
+take_zeroed (struct pool *pool)
+{
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (pool->zeroed_cnt > 0);
+
+  e = list_pop_front (&pool->zeroed);
+  pool->zeroed_cnt--;
+  memset (e, 0, sizeof *e);
+
+  if (pool->zeroed_cnt < pool->zeroed_max / 2 && !pool->refill_wanted)
+    {
+      pool->refill_wanted = true;
+      sema_up (&refill_sema);
+    }
+  return e;
+}
+
+/* Returns every page in POOL's stock of zeroed pages to its
+   free lists.  Interrupts must be off. */
+static void
+release_zeroed (struct pool *pool)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!list_empty (&pool->zeroed))
+    {
+      void *page = list_pop_front (&pool->zeroed);
+      size_t page_idx = pg_no (page) - pg_no (pool->base);
+      buddy_free (pool, page_idx, 1);
+    }
+  pool->zeroed_cnt = 0;
+}
+
+/* Takes one free page from POOL, zeroes it, and adds it to the
+   pool's stock.  The page is zeroed with interrupts on.
+   Returns false, and stops wanting a refill, if the stock
+   is already full or the pool has no free page to spare. */
+static bool
+refill_zeroed (struct pool *pool)
+{
+  enum intr_level old_level;
+  size_t page_idx;
+  void *page;
+
+  old_level = intr_disable ();
+  if (pool->zeroed_cnt >= pool->zeroed_max)
+    page_idx = BUDDY_ERROR;
+  else
+    page_idx = buddy_alloc (pool, 1);
+  if (page_idx == BUDDY_ERROR)
+    pool->refill_wanted = false;
+  intr_set_level (old_level);
+  if (page_idx == BUDDY_ERROR)
+    return false;
+
+  page = pool->base + PGSIZE * page_idx;
+  memset (page, 0, PGSIZE);
+
+  old_level = intr_disable ();
+  list_push_front (&pool->zeroed, page);
+  pool->zeroed_cnt++;
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Zeroing thread.  Refills the pools' stocks of zeroed pages one
+   page at a time, yielding the CPU between pages so that it only
+   gets the time other threads leave over, then sleeps until a
+   stock runs low again. */
+static void
+pagezero (void *aux UNUSED)
+{
+  for (;;)
+    {
+      bool kernel_more = true, user_more = true;
+
+      while (kernel_more || user_more)
+        {
+          if (kernel_more)
+            kernel_more = refill_zeroed (&kernel_pool);
+          if (user_more)
+            user_more = refill_zeroed (&user_pool);
+          thread_yield ();
+        }
+      sema_down (&refill_sema);
+    }
+}
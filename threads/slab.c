@@ -0,0 +1,268 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Object caches.
+
+   A cache hands out objects of a single type and size.  Objects
+   are carved out of "slabs", each of which is one page obtained
+   from the page allocator.  A slab begins with a header and a
+   stack of the indexes of its free objects, followed by the
+   objects themselves, packed without the rounding to a power of
+   2 that malloc() applies.
+
+   Each cache keeps its slabs on three lists: "partial" slabs
+   have both free and allocated objects, "full" slabs have no
+   free objects, and "empty" slabs have no allocated objects.
+   Allocation takes an object from a partial slab if there is
+   one, then from an empty slab, and only then creates a new
+   slab.  When freeing leaves a slab empty, it is kept for reuse
+   unless the cache already has an empty slab, in which case the
+   page goes back to the page allocator.
+
+   If a cache has a constructor, it is called once for each
+   object when its slab is created.  Objects are expected to be
+   returned to their constructed state before they are freed, so
+   slab_alloc() need not construct them again.  Free objects are
+   tracked by index in the slab header rather than by a link
+   stored inside the object, so freeing an object leaves its
+   contents alone. */
+
+/* A cache of objects of one type. */
+struct slab_cache
+  {
+    struct list_elem elem;      /* Element in all_caches. */
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Size of each object in bytes. */
+    size_t objs_per_slab;       /* Number of objects in a slab. */
+    size_t obj_ofs;             /* Offset of first object in a slab. */
+    slab_ctor_func *ctor;       /* Constructor, or null. */
+    struct lock lock;           /* Lock. */
+
+    struct list partial;        /* Slabs with some objects free. */
+    struct list full;           /* Slabs with no objects free. */
+    struct list empty;          /* Slabs with all objects free. */
+    size_t slab_cnt;            /* Number of slabs. */
+    size_t in_use;              /* Number of allocated objects. */
+  };
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Slab header, at the start of each slab's page. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct slab_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in cache's slab list. */
+    size_t free_cnt;            /* Number of free objects. */
+    uint16_t free_idx[];        /* Stack of free object indexes. */
+  };
+
+/* All the caches created so far. */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+
+static struct slab *new_slab (struct slab_cache *);
+static struct slab *obj_to_slab (struct slab_cache *, void *);
+static void *slab_obj (struct slab_cache *, struct slab *, size_t idx);
+
+/* Creates and returns a cache of objects of SIZE bytes named
+   NAME, for statistics.  If CTOR is nonnull, it is called for
+   each object as its slab is created.  SIZE must leave room for
+   at least one object in a page after the slab header.
+   Panics if memory is not available, since caches are created
+   once at initialization time. */
+struct slab_cache *
+slab_cache_create (const char *name, size_t size, slab_ctor_func *ctor)
+{
+  struct slab_cache *c;
+  size_t n;
+
+  ASSERT (size > 0);
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    PANIC ("%s: couldn't allocate object cache", name);
+
+  /* Fit as many objects as will go in a page along with the
+     header, the free index stack, and alignment padding. */
+  c->obj_size = ROUND_UP (size, sizeof (void *));
+  for (n = (PGSIZE - sizeof (struct slab)) / c->obj_size; n > 0; n--)
+    {
+      size_t ofs = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+                             sizeof (void *));
+      if (ofs + n * c->obj_size <= PGSIZE)
+        {
+          c->obj_ofs = ofs;
+          break;
+        }
+    }
+  ASSERT (n > 0);
+
+  c->name = name;
+  c->objs_per_slab = n;
+  c->ctor = ctor;
+  lock_init (&c->lock);
+  list_init (&c->partial);
+  list_init (&c->full);
+  list_init (&c->empty);
+  c->slab_cnt = 0;
+  c->in_use = 0;
+  list_push_back (&all_caches, &c->elem);
+  return c;
+}
+
+/* Obtains and returns a free object from cache C.
+   Returns a null pointer if memory is not available. */
+void *
+slab_alloc (struct slab_cache *c)
+{
+  struct slab *s;
+  void *obj;
+
+  lock_acquire (&c->lock);
+  if (!list_empty (&c->partial))
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+  else if (!list_empty (&c->empty))
+    {
+      s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+      list_push_front (&c->partial, &s->elem);
+    }
+  else
+    {
+      s = new_slab (c);
+      if (s == NULL)
+        {
+          lock_release (&c->lock);
+          return NULL;
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  obj = slab_obj (c, s, s->free_idx[--s->free_cnt]);
+  if (s->free_cnt == 0)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->full, &s->elem);
+    }
+  c->in_use++;
+  lock_release (&c->lock);
+  return obj;
+}
+
+/* Frees OBJ, which must have been allocated from cache C.
+   Does nothing if OBJ is null. */
+void
+slab_free (struct slab_cache *c, void *obj)
+{
+  struct slab *s;
+
+  if (obj == NULL)
+    return;
+
+  s = obj_to_slab (c, obj);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     its constructed state must be preserved. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+  ASSERT (s->free_cnt < c->objs_per_slab);
+  s->free_idx[s->free_cnt++] = ((uint8_t *) obj - (uint8_t *) s
+                                - c->obj_ofs) / c->obj_size;
+  c->in_use--;
+
+  if (s->free_cnt == 1 || s->free_cnt == c->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      if (s->free_cnt < c->objs_per_slab)
+        list_push_front (&c->partial, &s->elem);
+      else if (list_empty (&c->empty))
+        list_push_front (&c->empty, &s->elem);
+      else
+        {
+          c->slab_cnt--;
+          palloc_free_page (s);
+        }
+    }
+  lock_release (&c->lock);
+}
+
+/* Prints the number of objects in use and slabs held by each
+   cache. */
+void
+slab_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+      printf ("Slab cache %s: %zu objects of %zu bytes in use, "
+              "%zu slabs of %zu\n", c->name, c->in_use, c->obj_size,
+              c->slab_cnt, c->objs_per_slab);
+    }
+}
+
+/* Creates a slab for cache C, with all its objects free and
+   constructed.  Returns a null pointer if memory is not
+   available.  C's lock must be held. */
+static struct slab *
+new_slab (struct slab_cache *c)
+{
+  struct slab *s = palloc_get_page (0);
+  size_t i;
+
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->free_cnt = c->objs_per_slab;
+  for (i = 0; i < c->objs_per_slab; i++)
+    {
+      /* Hand out objects in address order. */
+      s->free_idx[i] = c->objs_per_slab - 1 - i;
+      if (c->ctor != NULL)
+        c->ctor (slab_obj (c, s, i));
+    }
+  c->slab_cnt++;
+  return s;
+}
+
+/* Returns the slab in cache C that contains OBJ. */
+static struct slab *
+obj_to_slab (struct slab_cache *c, void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  /* Check that the slab is valid and belongs to C. */
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT (pg_ofs (obj) >= c->obj_ofs);
+  ASSERT ((pg_ofs (obj) - c->obj_ofs) % c->obj_size == 0);
+
+  return s;
+}
+
+/* Returns the IDX'th object in slab S of cache C. */
+static void *
+slab_obj (struct slab_cache *c, struct slab *s, size_t idx)
+{
+  ASSERT (idx < c->objs_per_slab);
+  return (uint8_t *) s + c->obj_ofs + idx * c->obj_size;
+}
@@ -0,0 +1,15 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Initializes an object just carved out of a new slab. */
+typedef void slab_ctor_func (void *obj);
+
+struct slab_cache *slab_cache_create (const char *name, size_t size,
+                                      slab_ctor_func *);
+void *slab_alloc (struct slab_cache *) __attribute__ ((malloc));
+void slab_free (struct slab_cache *, void *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
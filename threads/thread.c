@@ -4,6 +4,7 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
@@ -147,6 +148,14 @@ thread_tick (void)
     intr_yield_on_return ();
 }
 
+/* Counts CNT timer ticks for which the idle thread was halted
+   without timer interrupts.  See timer_idle_enter(). */
+void
+thread_idle_ticks (int64_t cnt) 
+{
+  idle_ticks += cnt;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) 
@@ -180,8 +189,6 @@ thread_create (const char *name, int priority,
 	struct switch_threads_frame *sf;
 	tid_t tid;
 
-	printf( "thread_create -> name = %s\n", name );
-
 	ASSERT (function != NULL);
 
 	/* Allocate thread. */
@@ -419,6 +426,10 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Stop the timer from ticking while we wait, unless a
+         sleeping thread will need it. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -432,6 +443,7 @@ idle (void *idle_started_ UNUSED)
          See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
          7.11.1 "HLT Instruction". */
       asm volatile ("sti; hlt" : : : "memory");
+      timer_idle_exit ();
     }
 }
 
@@ -490,6 +502,11 @@ init_thread (struct thread *t, const char *name, int priority)
 	
 	// init file list
 	list_init(&t->file_list);
+
+#ifdef USERPROG
+	// init the list of segments that are only mapped once touched
+	list_init(&t->segments);
+#endif
 	
 	// set the parent thread
 	t->parent = NULL;
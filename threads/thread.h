@@ -79,10 +79,11 @@ typedef int tid_t;
    value, triggering the assertion. */
 /* The `elem' member has a dual purpose.  It can be an element in
    the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
+   semaphore wait list (synch.c), or in the list of sleeping
+   threads (devices/timer.c).  It can be used these ways only
+   because they are mutually exclusive: only a thread in the
    ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+   blocked state is on a semaphore wait list or asleep. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -96,10 +97,18 @@ struct thread
 	
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+
+    /* Owned by devices/timer.c. */
+    int64_t wakeup;                     /* When to wake, in timer_ns(). */
       
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+    bool pagedir_busy;                  /* Page directory being changed. */
+    uint8_t *heap_start;                /* Start of heap, past the data. */
+    uint8_t *heap_brk;                  /* End of heap (program break). */
+    struct file *executable;            /* Running executable, kept open. */
+    struct list segments;               /* Read-only segments, mapped lazily. */
 	
 	bool is_child_loaded;				/* Boolean to determine if a thread has been loaded false no, true yes */
 #endif
@@ -118,6 +127,9 @@ struct thread
     
     // Reference to parent thread will be used for passing return status to parent thread
     struct thread *parent;
+
+    // Our entry in the parent's children list, or NULL once the parent has exited
+    struct process *process;
 	
 	// Used when a thread waits for a child
     struct semaphore child_sem;
@@ -138,6 +150,7 @@ void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_idle_ticks (int64_t);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
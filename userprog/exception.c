@@ -2,8 +2,12 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "userprog/uaccess.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -89,6 +93,7 @@ kill (struct intr_frame *f)
       printf ("%s: dying due to interrupt %#04x (%s).\n",
               thread_name (), f->vec_no, intr_name (f->vec_no));
       intr_dump_frame (f);
+      thread_current ()->exit_code = -1;
       thread_exit (); 
 
     case SEL_KCSEG:
@@ -148,6 +153,31 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+  /* Heap pages and pages of read-only segments are mapped on
+     first touch, and swapped-out pages brought back in, whether
+     the process itself touches them or the kernel does on its
+     behalf during a system call. */
+  if (not_present && is_user_vaddr (fault_addr)
+      && thread_current ()->pagedir != NULL
+      && process_fault (fault_addr, write))
+    return;
+
+  /* A write to a page shared copy-on-write since fork gets a
+     private copy of the page, again whether the write comes from
+     the process or from the kernel in a system call. */
+  if (!not_present && write && is_user_vaddr (fault_addr)
+      && thread_current ()->pagedir != NULL
+      && pagedir_copy_on_write (thread_current ()->pagedir,
+                                pg_round_down (fault_addr)))
+    return;
+
+  /* Otherwise a fault by the kernel on a user address means that
+     the process handed a system call a bad pointer.  If the
+     kernel was accessing it through one of the user memory
+     routines, make the routine fail. */
+  if (!user && is_user_vaddr (fault_addr) && uaccess_fixup (f))
+    return;
+
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
      which fault_addr refers. */
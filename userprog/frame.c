@@ -0,0 +1,498 @@
+#include "userprog/frame.h"
+#include <debug.h>
+#include <hash.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/init.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
+#ifdef VM
+#include "vm/zswap.h"
+#endif
+
+/* A read-only page of an executable, shared by every process
+   that maps the same page of the same file. */
+struct text_page
+  {
+    struct hash_elem elem;      /* Element in text_pages. */
+    struct inode *inode;        /* File the page was read from. */
+    off_t ofs;                  /* Offset of the page in the file. */
+    size_t read_bytes;          /* Bytes read; the rest is zero. */
+    void *kpage;                /* Frame holding the page. */
+  };
+
+/* What we know about one physical frame. */
+struct frame
+  {
+    struct text_page *text;     /* Cache entry, if a text page. */
+    uint32_t ref_cnt;           /* Number of mappings. */
+  };
+
+/* Every physical page of RAM, indexed by physical page number.
+   Only frames from the user pool are ever in use. */
+static struct frame *frames;
+
+/* Text pages currently in memory, keyed by (inode, ofs,
+   read_bytes). */
+static struct hash text_pages;
+static struct slab_cache *text_page_cache;
+
+/* A frame of zeros that is never written.  Pages that must read
+   as zero are mapped to it until first written; see
+   frame_get_zero_page().  The frame table keeps a reference of its
+   own, so its count never drops to zero. */
+static void *zero_page;
+
+/* Accounting. */
+static size_t frames_used;                  /* Frames handed out. */
+static unsigned long long zero_fills;       /* Zero page writes. */
+static unsigned long long cow_copies;       /* Shared frames copied. */
+static unsigned long long cow_reuses;       /* COW faults on sole owner. */
+static unsigned long long text_hits;        /* Text pages found. */
+static unsigned long long text_misses;      /* Text pages read. */
+
+/* Protects FRAMES, TEXT_PAGES and the counters. */
+static struct lock frame_lock;
+
+static hash_hash_func text_page_hash;
+static hash_less_func text_page_less;
+
+/* Returns the entry in FRAMES for the frame at kernel virtual
+   address KPAGE. */
+static struct frame *
+frame_of (void *kpage)
+{
+  ASSERT (pg_ofs (kpage) == 0);
+  ASSERT (vtop (kpage) >> PGBITS < init_ram_pages);
+  return &frames[vtop (kpage) >> PGBITS];
+}
+
+/* Initializes the frame table. */
+void
+frame_init (void)
+{
+  size_t page_cnt = DIV_ROUND_UP (init_ram_pages * sizeof *frames, PGSIZE);
+
+  frames = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, page_cnt);
+  hash_init (&text_pages, text_page_hash, text_page_less, NULL);
+  text_page_cache = slab_cache_create ("text_page", sizeof (struct text_page),
+                                       NULL);
+  lock_init (&frame_lock);
+
+  zero_page = frame_get_page (PAL_ASSERT | PAL_ZERO);
+}
+
+/* Gives each of the PAGE_CNT frames starting at KPAGE, just
+   obtained from the user pool, a reference count of 1. */
+static void
+frame_register (uint8_t *kpage, size_t page_cnt)
+{
+  size_t i;
+
+  lock_acquire (&frame_lock);
+  for (i = 0; i < page_cnt; i++)
+    {
+      struct frame *f = frame_of (kpage + i * PGSIZE);
+
+      ASSERT (f->ref_cnt == 0);
+      f->ref_cnt = 1;
+      f->text = NULL;
+    }
+  frames_used += page_cnt;
+  lock_release (&frame_lock);
+}
+
+/* Obtains a frame from the user pool, as palloc_get_page()
+   would with FLAGS | PAL_USER, and gives it a reference count
+   of 1.  If no frame is free, evicts user pages until one is.
+   Returns a null pointer if no frame is free and none can be
+   evicted. */
+void *
+frame_get_page (enum palloc_flags flags)
+{
+  void *kpage = palloc_get_page (flags | PAL_USER);
+
+#ifdef VM
+  while (kpage == NULL && zswap_evict ())
+    kpage = palloc_get_page (flags | PAL_USER);
+#endif
+
+  if (kpage != NULL)
+    frame_register (kpage, 1);
+  return kpage;
+}
+
+/* Returns the shared zero frame, with a reference added for the
+   caller.  The caller must map it read-only, and copy-on-write if
+   the page is meant to be writable, so that the first write
+   replaces it by a private frame; see frame_unshare(). */
+void *
+frame_get_zero_page (void)
+{
+  frame_share (zero_page);
+  return zero_page;
+}
+
+/* Returns the number of bytes of file data in page I of a run of
+   pages that holds READ_BYTES bytes of file data in all. */
+static size_t
+page_read_bytes (size_t read_bytes, size_t i)
+{
+  if (read_bytes <= i * PGSIZE)
+    return 0;
+  read_bytes -= i * PGSIZE;
+  return read_bytes < PGSIZE ? read_bytes : PGSIZE;
+}
+
+/* Looks up the page of INODE at OFS holding READ_BYTES bytes of
+   data in the text page cache.  If it is there, adds a reference
+   to its frame and returns the frame; otherwise returns a null
+   pointer.  The caller must hold frame_lock. */
+static void *
+lookup_text_page (struct inode *inode, off_t ofs, size_t read_bytes)
+{
+  struct text_page key;
+  struct hash_elem *e;
+  struct text_page *tp;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  key.inode = inode;
+  key.ofs = ofs;
+  key.read_bytes = read_bytes;
+  e = hash_find (&text_pages, &key.elem);
+  if (e == NULL)
+    return NULL;
+
+  tp = hash_entry (e, struct text_page, elem);
+  frame_of (tp->kpage)->ref_cnt++;
+  return tp->kpage;
+}
+
+/* Enters KPAGE, which holds READ_BYTES bytes of INODE at OFS and
+   to which the caller has the only reference, into the text page
+   cache.  If another thread entered the same page first, trades
+   the caller's reference to KPAGE for one to that thread's frame.
+   Returns the frame the caller should map. */
+static void *
+insert_text_page (struct inode *inode, off_t ofs, size_t read_bytes,
+                  void *kpage)
+{
+  struct text_page *tp;
+  void *winner;
+  bool fs;
+
+  tp = slab_alloc (text_page_cache);
+  if (tp == NULL)
+    return kpage;               /* Still usable, just not shared. */
+  tp->inode = inode;
+  tp->ofs = ofs;
+  tp->read_bytes = read_bytes;
+  tp->kpage = kpage;
+
+  lock_acquire (&frame_lock);
+  winner = lookup_text_page (inode, ofs, read_bytes);
+  if (winner == NULL)
+    {
+      hash_insert (&text_pages, &tp->elem);
+      frame_of (kpage)->text = tp;
+    }
+  lock_release (&frame_lock);
+
+  if (winner != NULL)
+    {
+      slab_free (text_page_cache, tp);
+      frame_put_page (kpage);
+      return winner;
+    }
+  fs = syscall_fs_lock ();
+  inode_reopen (inode);
+  inode_deny_write (inode);
+  syscall_fs_unlock (fs);
+  return kpage;
+}
+
+/* Reads pages FIRST through LAST - 1 of the run described to
+   frame_get_text_pages(), none of which is in the text page
+   cache, with a single read into frames that are contiguous in
+   kernel memory if possible, and stores their frames into
+   KPAGES.  Returns false, having released any frames it
+   obtained, if memory allocation or the read fails. */
+static bool
+read_text_pages (struct file *file, off_t ofs, size_t read_bytes,
+                 size_t first, size_t last, void **kpages)
+{
+  size_t page_cnt = last - first;
+  size_t run_bytes = 0;
+  uint8_t *run;
+  off_t got;
+  size_t i;
+  bool fs;
+
+  for (i = first; i < last; i++)
+    run_bytes += page_read_bytes (read_bytes, i);
+
+  run = page_cnt > 1 ? palloc_get_multiple (PAL_USER, page_cnt) : NULL;
+  if (run == NULL)
+    {
+      /* Fall back to a page at a time. */
+      for (i = first; i < last; i++)
+        {
+          size_t bytes = page_read_bytes (read_bytes, i);
+
+          kpages[i] = frame_get_page (0);
+          if (kpages[i] != NULL)
+            {
+              fs = syscall_fs_lock ();
+              got = file_read_at (file, kpages[i], bytes, ofs + i * PGSIZE);
+              syscall_fs_unlock (fs);
+            }
+          if (kpages[i] == NULL || got != (off_t) bytes)
+            {
+              if (kpages[i] != NULL)
+                frame_put_page (kpages[i]);
+              while (i-- > first)
+                frame_put_page (kpages[i]);
+              return false;
+            }
+          memset ((uint8_t *) kpages[i] + bytes, 0, PGSIZE - bytes);
+        }
+      return true;
+    }
+
+  frame_register (run, page_cnt);
+  fs = syscall_fs_lock ();
+  got = file_read_at (file, run, run_bytes, ofs + first * PGSIZE);
+  syscall_fs_unlock (fs);
+  if (got != (off_t) run_bytes)
+    {
+      for (i = 0; i < page_cnt; i++)
+        frame_put_page (run + i * PGSIZE);
+      return false;
+    }
+  memset (run + run_bytes, 0, page_cnt * PGSIZE - run_bytes);
+
+  for (i = first; i < last; i++)
+    kpages[i] = run + (i - first) * PGSIZE;
+  return true;
+}
+
+/* Obtains frames for PAGE_CNT consecutive pages of FILE starting
+   at page-aligned offset OFS, which together hold READ_BYTES
+   bytes of the file followed by zeros, and stores them into
+   KPAGES, with a reference added for the caller, who must map
+   them read-only.  Pages that another process already has in
+   memory are shared rather than read again, and pages of nothing
+   but zeros are the shared zero frame.  Each run of pages that
+   must come from disk is read with a single file_read_at(),
+   which the file system turns into multi-sector reads.  While any
+   text page of a file is in memory, writes to the file are
+   denied, so shared pages never go stale.  Like every other
+   file system access, the reads and inode calls here run under
+   syscall_lock.
+   A page that cannot be obtained, because memory allocation or
+   the read fails, gets a null pointer in KPAGES. */
+void
+frame_get_text_pages (struct file *file, off_t ofs, size_t read_bytes,
+                      size_t page_cnt, void **kpages)
+{
+  struct inode *inode = file_get_inode (file);
+  size_t i;
+
+  ASSERT (ofs % PGSIZE == 0);
+  ASSERT (read_bytes <= page_cnt * PGSIZE);
+
+  /* Take what is already in memory. */
+  lock_acquire (&frame_lock);
+  for (i = 0; i < page_cnt; i++)
+    {
+      size_t bytes = page_read_bytes (read_bytes, i);
+
+      if (bytes == 0)
+        {
+          frame_of (zero_page)->ref_cnt++;
+          kpages[i] = zero_page;
+        }
+      else
+        {
+          kpages[i] = lookup_text_page (inode, ofs + i * PGSIZE, bytes);
+          if (kpages[i] != NULL)
+            text_hits++;
+          else
+            text_misses++;
+        }
+    }
+  lock_release (&frame_lock);
+
+  /* Read the rest, a run of consecutive missing pages at a
+     time, without holding the lock. */
+  for (i = 0; i < page_cnt; )
+    {
+      size_t last;
+
+      if (kpages[i] != NULL)
+        {
+          i++;
+          continue;
+        }
+      for (last = i + 1; last < page_cnt && kpages[last] == NULL; last++)
+        continue;
+
+      if (read_text_pages (file, ofs, read_bytes, i, last, kpages))
+        for (; i < last; i++)
+          kpages[i] = insert_text_page (inode, ofs + i * PGSIZE,
+                                        page_read_bytes (read_bytes, i),
+                                        kpages[i]);
+      else
+        for (; i < last; i++)
+          kpages[i] = NULL;
+    }
+}
+
+/* Adds a reference to frame KPAGE, which must already have
+   one. */
+void
+frame_share (void *kpage)
+{
+  struct frame *f = frame_of (kpage);
+
+  lock_acquire (&frame_lock);
+  ASSERT (f->ref_cnt > 0);
+  ASSERT (f->ref_cnt < UINT32_MAX);
+  f->ref_cnt++;
+  lock_release (&frame_lock);
+}
+
+/* Drops a reference to frame KPAGE, freeing it when the last
+   reference goes away. */
+void
+frame_put_page (void *kpage)
+{
+  struct frame *f = frame_of (kpage);
+  struct text_page *tp = NULL;
+  bool last, fs;
+
+  lock_acquire (&frame_lock);
+  ASSERT (f->ref_cnt > 0);
+  last = --f->ref_cnt == 0;
+  if (last)
+    {
+      frames_used--;
+      if (f->text != NULL)
+        {
+          tp = f->text;
+          f->text = NULL;
+          hash_delete (&text_pages, &tp->elem);
+        }
+    }
+  lock_release (&frame_lock);
+
+  if (tp != NULL)
+    {
+      fs = syscall_fs_lock ();
+      inode_allow_write (tp->inode);
+      inode_close (tp->inode);
+      syscall_fs_unlock (fs);
+      slab_free (text_page_cache, tp);
+    }
+  if (last)
+    palloc_free_page (kpage);
+}
+
+/* Gives the caller, which holds one of the references to frame
+   KPAGE, a frame of its own with the same contents, for a write
+   to a copy-on-write page.  If the caller's reference is the only
+   one, that is KPAGE itself; otherwise the caller's reference to
+   KPAGE is traded for one to a new copy.  A caller's reference
+   stays its only one until the caller itself shares the frame,
+   so the answer cannot change under it.
+   Returns a null pointer, keeping the reference to KPAGE, if
+   memory allocation fails. */
+void *
+frame_unshare (void *kpage)
+{
+  bool zero = kpage == zero_page;
+  void *copy;
+
+  lock_acquire (&frame_lock);
+  if (frame_of (kpage)->ref_cnt == 1)
+    {
+      ASSERT (!zero);
+      cow_reuses++;
+      lock_release (&frame_lock);
+      return kpage;
+    }
+  lock_release (&frame_lock);
+
+  /* Pre-zeroed frames are usually at hand, so a write to the zero
+     page need not copy anything. */
+  copy = frame_get_page (zero ? PAL_ZERO : 0);
+  if (copy == NULL)
+    return NULL;
+  if (!zero)
+    memcpy (copy, kpage, PGSIZE);
+
+  lock_acquire (&frame_lock);
+  if (zero)
+    zero_fills++;
+  else
+    cow_copies++;
+  lock_release (&frame_lock);
+
+  frame_put_page (kpage);
+  return copy;
+}
+
+/* Returns true if frame KPAGE may be evicted: it is mapped by a
+   single page, and is neither a shared text page nor the zero
+   frame.  Frames mapped more than once would have to be unmapped
+   from every page directory at once, and text pages can simply be
+   read again. */
+bool
+frame_evictable (void *kpage)
+{
+  struct frame *f = frame_of (kpage);
+  return f->ref_cnt == 1 && f->text == NULL && kpage != zero_page;
+}
+
+/* Prints frame statistics. */
+void
+frame_print_stats (void)
+{
+  printf ("Frames: %zu in use, %"PRIu32" zero page mappings, "
+          "%llu zero fills, %llu COW copies, %llu COW reuses\n",
+          frames_used, frame_of (zero_page)->ref_cnt - 1,
+          zero_fills, cow_copies, cow_reuses);
+  printf ("Frames: %zu shared text pages, %llu text hits, %llu misses\n",
+          hash_size (&text_pages), text_hits, text_misses);
+}
+
+/* Returns a hash value for text page E. */
+static unsigned
+text_page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct text_page *tp = hash_entry (e, struct text_page, elem);
+  return hash_bytes (&tp->inode, sizeof tp->inode) ^ hash_int (tp->ofs);
+}
+
+/* Returns true if text page A precedes text page B. */
+static bool
+text_page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+                void *aux UNUSED)
+{
+  const struct text_page *a = hash_entry (a_, struct text_page, elem);
+  const struct text_page *b = hash_entry (b_, struct text_page, elem);
+
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  if (a->ofs != b->ofs)
+    return a->ofs < b->ofs;
+  return a->read_bytes < b->read_bytes;
+}
@@ -0,0 +1,34 @@
+#ifndef USERPROG_FRAME_H
+#define USERPROG_FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+#include "threads/palloc.h"
+
+struct file;
+
+/* Physical frames that back user pages.
+
+   Every frame handed out by frame_get_page() carries a reference
+   count, one per page table entry that maps it.  Frames mapped
+   by more than one process (after fork) are shared read-only
+   until one of the mappers writes to them.  Read-only pages of
+   executables are shared the same way between every process
+   running the same program, and every page that has only ever
+   been read as zeros is mapped to a single shared zero frame.
+   When the user pool runs dry, frames that only one page maps
+   are evicted to the compressed swap cache (VM builds only). */
+
+void frame_init (void);
+void *frame_get_page (enum palloc_flags);
+void *frame_get_zero_page (void);
+void frame_get_text_pages (struct file *, off_t ofs, size_t read_bytes,
+                           size_t page_cnt, void **kpages);
+void frame_share (void *kpage);
+void frame_put_page (void *kpage);
+void *frame_unshare (void *kpage);
+bool frame_evictable (void *kpage);
+void frame_print_stats (void);
+
+#endif /* userprog/frame.h */
@@ -1,13 +1,53 @@
 #include "userprog/pagedir.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#include "threads/thread.h"
+#include "userprog/frame.h"
+#ifdef VM
+#include "vm/zswap.h"
+#endif
 
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
+static void invlpg (const void *);
+
+/* TLB invalidation statistics. */
+static unsigned long long tlb_reloads;  /* Whole TLB, by reloading CR3. */
+static unsigned long long tlb_invlpgs;  /* Single pages, by INVLPG. */
+static unsigned long long tlb_flushes;  /* Batches. */
+static uint32_t *lookup_page (uint32_t *pd, const void *vaddr, bool create);
+
+/* Returns the user virtual address of the page that page table
+   entry PTE, in page table PT, maps within page directory PD, for
+   directory entry PDE. */
+static void *
+pte_upage (uint32_t *pd, uint32_t *pde, uint32_t *pt, uint32_t *pte)
+{
+  return (void *) (((pde - pd) << PDSHIFT) | ((pte - pt) << PTSHIFT));
+}
+
+/* Marks the running process's page directory as being changed,
+   so that the evictor leaves its pages alone until end_change().
+   Sequences that read a frame out of a page table entry and then
+   use it must be bracketed this way. */
+static void
+begin_change (void)
+{
+  thread_current ()->pagedir_busy = true;
+}
+
+/* Ends a change begun with begin_change(). */
+static void
+end_change (void)
+{
+  thread_current ()->pagedir_busy = false;
+}
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -22,8 +62,10 @@ pagedir_create (void)
   return pd;
 }
 
-/* Destroys page directory PD, freeing all the pages it
-   references. */
+/* Destroys page directory PD, dropping its reference to every
+   frame it maps, and to every page of it that was swapped out,
+   and freeing its page tables.  PD must no longer be visible to
+   the evictor, that is, no thread's pagedir. */
 void
 pagedir_destroy (uint32_t *pd) 
 {
@@ -41,12 +83,237 @@ pagedir_destroy (uint32_t *pd)
         
         for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
           if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
+            frame_put_page (pte_get_page (*pte));
+#ifdef VM
+          else if (*pte & PTE_SWAP)
+            zswap_discard (pd, pte_upage (pd, pde, pt, pte));
+#endif
         palloc_free_page (pt);
       }
   palloc_free_page (pd);
 }
 
+/* Creates a copy of page directory PD that maps every user page
+   to the same frame as PD does, for fork.  Writable pages become
+   read-only and copy-on-write in both directories, so that
+   neither process sees the other's later writes; see
+   pagedir_copy_on_write().  Only page tables are allocated, so
+   the cost is proportional to the size of PD's page tables, not
+   to the memory it maps.  Pages that are swapped out are shared
+   too, until one of the processes brings its copy back in.
+   PD must be the running process's page directory.
+   Returns the new page directory, or a null pointer if memory
+   allocation fails. */
+uint32_t *
+pagedir_fork (uint32_t *pd)
+{
+  uint32_t *child, *pde;
+  bool success = true;
+
+  child = pagedir_create ();
+  if (child == NULL)
+    return NULL;
+
+  begin_change ();
+  for (pde = pd; success && pde < pd + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P)
+      {
+        uint32_t *pt = pde_get_pt (*pde);
+        uint32_t *child_pt = palloc_get_page (PAL_ZERO);
+        size_t i;
+
+        if (child_pt == NULL)
+          {
+            success = false;
+            break;
+          }
+        child[pde - pd] = pde_create (child_pt);
+
+        for (i = 0; i < PGSIZE / sizeof *pt; i++)
+          if (pt[i] & PTE_P)
+            {
+              if (pt[i] & PTE_W)
+                pt[i] = (pt[i] & ~(uint32_t) PTE_W) | PTE_COW;
+              child_pt[i] = pt[i];
+              frame_share (pte_get_page (pt[i]));
+            }
+#ifdef VM
+          else if (pt[i] & PTE_SWAP)
+            {
+              if (!zswap_fork (pd, child, pte_upage (pd, pde, pt, &pt[i])))
+                {
+                  success = false;
+                  break;
+                }
+              child_pt[i] = pt[i];
+            }
+#endif
+      }
+
+  /* PD's writable pages just became read-only. */
+  invalidate_pagedir (pd);
+  end_change ();
+
+  if (!success)
+    {
+      pagedir_destroy (child);
+      child = NULL;
+    }
+  return child;
+}
+
+/* Resolves a write fault on copy-on-write page UPAGE in PD.  If
+   some other page directory still shares the frame, or it is the
+   shared zero frame, UPAGE gets a private copy of it; otherwise
+   the existing frame is simply made writable again.
+   PD must be the running process's page directory.
+   Returns true if successful, false if UPAGE is not a
+   copy-on-write page or if memory allocation fails. */
+bool
+pagedir_copy_on_write (uint32_t *pd, const void *upage)
+{
+  uint32_t *pte;
+  void *kpage;
+  bool success = false;
+
+  ASSERT (is_user_vaddr (upage));
+
+  begin_change ();
+  pte = lookup_page (pd, upage, false);
+  if (pte != NULL && (*pte & (PTE_P | PTE_COW)) == (PTE_P | PTE_COW))
+    {
+      kpage = frame_unshare (pte_get_page (*pte));
+      if (kpage != NULL)
+        {
+          *pte = pte_create_user (kpage, true);
+          invalidate_page (pd, upage);
+          success = true;
+        }
+    }
+  end_change ();
+  return success;
+}
+
+/* Removes user virtual page UPAGE from page directory PD,
+   dropping PD's reference to the frame it maps or, if it was
+   swapped out, to the swapped-out copy.  UPAGE need not be
+   mapped.
+   PD must be the running process's page directory. */
+void
+pagedir_drop_page (uint32_t *pd, void *upage)
+{
+  uint32_t *pte;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  begin_change ();
+  pte = lookup_page (pd, upage, false);
+  if (pte != NULL && (*pte & PTE_P))
+    {
+      void *kpage = pte_get_page (*pte);
+      *pte = 0;
+      invalidate_page (pd, upage);
+      frame_put_page (kpage);
+    }
+#ifdef VM
+  else if (pte != NULL && (*pte & PTE_SWAP))
+    {
+      *pte = 0;
+      zswap_discard (pd, upage);
+    }
+#endif
+  end_change ();
+}
+
+/* Calls SCAN for each page mapped in page directory PD, in
+   increasing order of user virtual address starting from START,
+   with the page's user virtual address, the frame it maps and
+   AUX, until SCAN returns true.  Returns the user virtual address
+   of the page for which SCAN returned true, or a null pointer if
+   it never did. */
+void *
+pagedir_scan (uint32_t *pd, const void *start, pagedir_scan_func *scan,
+              void *aux)
+{
+  uint32_t *pde;
+
+  ASSERT (is_user_vaddr (start) || start == PHYS_BASE);
+
+  for (pde = pd + pd_no (start); pde < pd + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P)
+      {
+        uint32_t *pt = pde_get_pt (*pde);
+        uint32_t *pte = pt;
+
+        if (pde == pd + pd_no (start))
+          pte += pt_no (start);
+        for (; pte < pt + PGSIZE / sizeof *pte; pte++)
+          if (*pte & PTE_P)
+            {
+              void *upage = pte_upage (pd, pde, pt, pte);
+              if (scan (pd, upage, pte_get_page (*pte), aux))
+                return upage;
+            }
+      }
+  return NULL;
+}
+
+/* Marks user virtual page UPAGE in page directory PD, which must
+   be mapped, as swapped out, and returns the frame it mapped,
+   whose reference passes to the caller.  Further accesses to
+   UPAGE fault until pagedir_swap_in() maps a frame again. */
+void *
+pagedir_swap_out (uint32_t *pd, void *upage)
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+  void *kpage;
+
+  ASSERT (pte != NULL && (*pte & PTE_P));
+
+  kpage = pte_get_page (*pte);
+  *pte = (*pte & (PTE_W | PTE_COW)) | PTE_SWAP;
+  invalidate_page (pd, upage);
+  return kpage;
+}
+
+/* Returns true if user virtual page UPAGE in PD is swapped
+   out. */
+bool
+pagedir_is_swapped (uint32_t *pd, const void *upage)
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+  return pte != NULL && (*pte & (PTE_P | PTE_SWAP)) == PTE_SWAP;
+}
+
+/* Maps swapped-out user virtual page UPAGE in PD to KPAGE, with
+   the access rights it had when it was swapped out.  The caller's
+   reference to KPAGE passes to PD. */
+void
+pagedir_swap_in (uint32_t *pd, void *upage, void *kpage)
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+
+  ASSERT (pte != NULL && (*pte & (PTE_P | PTE_SWAP)) == PTE_SWAP);
+  *pte = pte_create_user (kpage, false) | (*pte & (PTE_W | PTE_COW));
+}
+
+/* Adds a mapping in page directory PD from user virtual page
+   UPAGE to the frame at KPAGE that is read-only until first
+   written, at which point pagedir_copy_on_write() gives UPAGE a
+   frame of its own.
+   UPAGE must not already be mapped.
+   Returns true if successful, false if memory allocation
+   failed. */
+bool
+pagedir_set_page_cow (uint32_t *pd, void *upage, void *kpage)
+{
+  if (!pagedir_set_page (pd, upage, kpage, false))
+    return false;
+  *lookup_page (pd, upage, false) |= PTE_COW;
+  return true;
+}
+
 /* Returns the address of the page table entry for virtual
    address VADDR in page directory PD.
    If PD does not have a page table for VADDR, behavior depends
@@ -110,7 +377,7 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
 
   if (pte != NULL) 
     {
-      ASSERT ((*pte & PTE_P) == 0);
+      ASSERT ((*pte & (PTE_P | PTE_SWAP)) == 0);
       *pte = pte_create_user (kpage, writable);
       return true;
     }
@@ -152,7 +419,7 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
     }
 }
 
@@ -180,7 +447,7 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -209,9 +476,83 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
+        }
+    }
+}
+
+/* Clears the accessed bit in the PTE for virtual page VPAGE in
+   PD, and returns whether it was set.  Rather than invalidating
+   the TLB entry for VPAGE straight away, adds VPAGE to BATCH, to
+   be invalidated along with the others there by
+   pagedir_batch_flush().  Until then the CPU may go on using the
+   stale entry, and so not set the accessed bit again; that only
+   makes the bit a little less precise, which is fine for a page
+   replacement policy. */
+bool
+pagedir_test_and_clear_accessed (uint32_t *pd, const void *vpage,
+                                 struct pagedir_batch *batch)
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+
+  ASSERT (batch->pd == pd);
+
+  if (pte == NULL || (*pte & PTE_A) == 0)
+    return false;
+  *pte &= ~(uint32_t) PTE_A;
+  pagedir_batch_add (batch, vpage);
+  return true;
+}
+
+/* Initializes BATCH to collect pages of PD whose TLB entries are
+   stale. */
+void
+pagedir_batch_init (struct pagedir_batch *batch, uint32_t *pd)
+{
+  batch->pd = pd;
+  batch->page_cnt = 0;
+}
+
+/* Adds VPAGE, whose PTE in BATCH's page directory the caller has
+   just changed, to BATCH. */
+void
+pagedir_batch_add (struct pagedir_batch *batch, const void *vpage)
+{
+  if (batch->page_cnt < PAGEDIR_BATCH_PAGES)
+    batch->pages[batch->page_cnt] = vpage;
+  batch->page_cnt++;
+}
+
+/* Invalidates the TLB entries of every page in BATCH, and empties
+   it.  A few pages are invalidated one at a time; past
+   PAGEDIR_BATCH_PAGES, reloading CR3 to flush the whole TLB is
+   cheaper. */
+void
+pagedir_batch_flush (struct pagedir_batch *batch)
+{
+  if (batch->page_cnt > 0 && active_pd () == batch->pd)
+    {
+      if (batch->page_cnt > PAGEDIR_BATCH_PAGES)
+        pagedir_activate (batch->pd);
+      else
+        {
+          size_t i;
+
+          for (i = 0; i < batch->page_cnt; i++)
+            invlpg (batch->pages[i]);
         }
+      tlb_flushes++;
     }
+  batch->page_cnt = 0;
+}
+
+/* Prints TLB invalidation statistics. */
+void
+pagedir_print_stats (void)
+{
+  printf ("TLB: %llu full flushes, %llu single-page invalidations, "
+          "%llu batched flushes\n",
+          tlb_reloads, tlb_invlpgs, tlb_flushes);
 }
 
 /* Loads page directory PD into the CPU's page directory base
@@ -230,6 +571,14 @@ pagedir_activate (uint32_t *pd)
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
 }
 
+/* Returns true if PD, or the kernel-only page directory if PD is
+   a null pointer, is the one loaded in the CPU. */
+bool
+pagedir_is_active (uint32_t *pd)
+{
+  return active_pd () == (pd != NULL ? pd : init_page_dir);
+}
+
 /* Returns the currently active page directory. */
 static uint32_t *
 active_pd (void) 
@@ -259,5 +608,28 @@ invalidate_pagedir (uint32_t *pd)
       /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
          "Translation Lookaside Buffers (TLBs)". */
       pagedir_activate (pd);
+      tlb_reloads++;
     } 
 }
+
+/* Invalidates the TLB entry for virtual page VPAGE if PD is the
+   active page directory.  Cheaper than invalidate_pagedir() when
+   a single PTE changed, because the rest of the TLB survives. */
+static void
+invalidate_page (uint32_t *pd, const void *vpage)
+{
+  if (active_pd () == pd)
+    {
+      invlpg (vpage);
+      tlb_invlpgs++;
+    }
+}
+
+/* Invalidates the TLB entry for the page containing virtual
+   address VADDR, in every address space.  See [IA32-v2a]
+   "INVLPG--Invalidate TLB Entry". */
+static void
+invlpg (const void *vaddr)
+{
+  asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
+}
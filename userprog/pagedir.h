@@ -2,17 +2,51 @@
 #define USERPROG_PAGEDIR_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+/* Most pages a pagedir_batch invalidates one by one. */
+#define PAGEDIR_BATCH_PAGES 32
+
+/* Pages of one page directory whose TLB entries have gone stale,
+   to be invalidated all at once by pagedir_batch_flush(), so that
+   many PTE changes cost one round of invalidations. */
+struct pagedir_batch
+  {
+    uint32_t *pd;                       /* Page directory. */
+    size_t page_cnt;                    /* Pages added so far. */
+    const void *pages[PAGEDIR_BATCH_PAGES]; /* The first pages. */
+  };
+
 uint32_t *pagedir_create (void);
 void pagedir_destroy (uint32_t *pd);
+uint32_t *pagedir_fork (uint32_t *pd);
+bool pagedir_copy_on_write (uint32_t *pd, const void *upage);
+void pagedir_drop_page (uint32_t *pd, void *upage);
+
+/* Called by pagedir_scan() for each mapped page. */
+typedef bool pagedir_scan_func (uint32_t *pd, void *upage, void *kpage,
+                                void *aux);
+void *pagedir_scan (uint32_t *pd, const void *start, pagedir_scan_func *,
+                    void *aux);
+void *pagedir_swap_out (uint32_t *pd, void *upage);
+bool pagedir_is_swapped (uint32_t *pd, const void *upage);
+void pagedir_swap_in (uint32_t *pd, void *upage, void *kpage);
 bool pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool rw);
+bool pagedir_set_page_cow (uint32_t *pd, void *upage, void *kpage);
 void *pagedir_get_page (uint32_t *pd, const void *upage);
 void pagedir_clear_page (uint32_t *pd, void *upage);
 bool pagedir_is_dirty (uint32_t *pd, const void *upage);
 void pagedir_set_dirty (uint32_t *pd, const void *upage, bool dirty);
 bool pagedir_is_accessed (uint32_t *pd, const void *upage);
 void pagedir_set_accessed (uint32_t *pd, const void *upage, bool accessed);
+bool pagedir_test_and_clear_accessed (uint32_t *pd, const void *upage,
+                                      struct pagedir_batch *);
+void pagedir_batch_init (struct pagedir_batch *, uint32_t *pd);
+void pagedir_batch_add (struct pagedir_batch *, const void *upage);
+void pagedir_batch_flush (struct pagedir_batch *);
+void pagedir_print_stats (void);
 void pagedir_activate (uint32_t *pd);
+bool pagedir_is_active (uint32_t *pd);
 
 #endif /* userprog/pagedir.h */
@@ -5,33 +5,98 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time-page.h>
+#include "userprog/frame.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "devices/timer.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/zswap.h"
+#endif
 
 // boolean used to hide debug logs
-static bool DebugLogs = true;
+static bool DebugLogs = false;
+
+// object cache that every struct process is allocated from
+static struct slab_cache *process_cache;
+
+// the heap may not grow to within this many bytes of PHYS_BASE, which is left for the stack
+#define STACK_RESERVE (8 * 1024 * 1024)
+
+// most pages of a read-only segment that one fault may map, see process_text_fault
+#define FAULT_AROUND_MAX 64
+
+// pages of a read-only segment that one fault maps, set by the -fault-around option
+size_t fault_around_pages = 16;
+
+// faults on read-only segments, and pages those faults mapped
+static unsigned long long text_faults, text_pages_mapped;
+
+// frame holding the time page, which every process maps read-only at TIME_PAGE_ADDR. we keep
+// a reference of our own, so it is never freed or evicted
+static void *time_kpage;
+
+// context switches into a kernel thread, which leave the page directory alone, and into a
+// process, split by whether its page directory had to be loaded
+static unsigned long long lazy_switches, cr3_skips, cr3_loads;
+
+// a read-only segment of the running executable. its pages are mapped when first touched
+struct segment
+{
+	struct list_elem elem;					// element in the thread's segments list
+	uint8_t *upage;							// first user page
+	size_t page_cnt;						// number of pages
+	off_t ofs;								// file offset of the first page
+	uint32_t read_bytes;					// bytes of file data, the rest reads as zeros
+};
 
 static thread_func start_process NO_RETURN;
+static thread_func start_fork NO_RETURN;
+static bool copy_segments (struct thread *from);
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool install_time_page (void);
 
 struct process *process_create (tid_t tid);
 struct process *get_child_process (struct thread *t, tid_t child_tid);
+static void release_child (struct process *p);
 void update_parent_process_status (struct thread *child, enum process_status status);
 
+// called on boot to set up the cache that process_create allocates from
+void
+process_init (void)
+{
+	process_cache = slab_cache_create ("process", sizeof (struct process), NULL);
+
+	// the timer keeps the time page up to date from here on
+	time_kpage = frame_get_page (PAL_ASSERT | PAL_ZERO);
+	timer_publish (time_kpage);
+}
+
+// handed from process_execute to the first function its child runs
+struct start_info
+{
+	char *file_name;						// page holding the command line, freed by the child
+	struct process *process;				// the parent's entry for the child
+};
+
 /* Starts a new thread running a user program loaded from
-   FILENAME.  The new thread may be scheduled (and may even exit)
-   before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+   FILENAME, and waits until it has loaded.  The new thread may
+   exit before process_execute() returns.  Returns the new
+   process's thread id, or TID_ERROR if the thread cannot be
+   created or the program cannot be loaded. */
 tid_t
 process_execute (const char *file_name) 
 {
@@ -43,6 +108,7 @@ process_execute (const char *file_name)
 	tid_t tid;			// reference to current thread id 
 	struct thread *cur; // reference to current thread
 	struct process *cur_p;  // reference to our process information
+	struct start_info info;	// handed to start_process
 
 	/* Make a copy of FILE_NAME.
 	Otherwise there's a race between the caller and load(). */
@@ -66,49 +132,47 @@ process_execute (const char *file_name)
 	if(DebugLogs) // debug log
 		printf("process_execute -> real_name = %s  file_name = %s\n", real_name, file_name);
 
-	/* Create a new thread to execute FILE_NAME. */
-	tid = thread_create (real_name, PRI_DEFAULT, start_process, fn_copy);
-	
-	// if error free page
-	if (tid == TID_ERROR)
-	{
-		palloc_free_page (fn_copy); 	
-	}
-	
 	// get the current thread
 	cur = thread_current();
 	
-	// current process create with thread id
-	cur_p = process_create (tid);
-
-	// if the current process is null then woopies we failed to create a new process
+	// the child's entry goes on our children list before it can run, so that it always has
+	// somewhere to report its load result and exit status
+	cur_p = process_create (TID_ERROR);
 	if (cur_p == NULL)
 	{
-		// free page and return -1
-		palloc_free_page (fn_copy); 
-		
-		// free process
-		free(cur_p);
-		
 		if(DebugLogs) // debug log
 			printf("process_execute() -> cur_p == NULL\n");
 		
-		return -1;
+		palloc_free_page (fn_copy); 
+		return TID_ERROR;
 	}
-
-	// Inserts ELEM just before BEFORE, which may be either an interior element or a tail.
 	list_push_back (&cur->children, &cur_p->elem);
+
+	/* Create a new thread to execute FILE_NAME. */
+	info.file_name = fn_copy;
+	info.process = cur_p;
+	tid = thread_create (real_name, PRI_DEFAULT, start_process, &info);
+	
+	// if error free page
+	if (tid == TID_ERROR)
+	{
+		palloc_free_page (fn_copy); 	
+		release_child (cur_p);
+		return TID_ERROR;
+	}
+	cur_p->pid = (pid_t) tid;
+
+	// INFO lives on our stack, so wait until the child has loaded (or failed to)
+	sema_down (&cur_p->sema_initialization);
 	
 	// check process load status if is failed then return -1
 	if (cur_p->process_status == LOAD_FAILED)
 	{
 		if(DebugLogs) // debug log
 			printf("cur_p->process_status == LOAD_FAILED\n");
+		release_child (cur_p);
 		return -1;	
 	}
-	
-	//Frees block P, which must have been previously allocated with malloc(), calloc(), or realloc().
-	//free(cur_p);
 
 	// if we are successful then woola
 	return tid;
@@ -117,11 +181,17 @@ process_execute (const char *file_name)
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *info_)
 {
-  	char *file_name = file_name_;
+	struct start_info *info = info_;
+  	char *file_name = info->file_name;
+	struct thread *t = thread_current ();
   	struct intr_frame if_;
   	bool success;
+
+	// from here on we report our exit status to our parent's entry for us
+	t->process = info->process;
+	t->process->thread = t;
 	
 	if(DebugLogs) // debug log
 		printf("start_process -> file_name = %s\n", file_name);
@@ -135,20 +205,22 @@ start_process (void *file_name_)
 	// return success on load
 	success = load (file_name, &if_.eip, &if_.esp);
 
-	/* If load failed, quit. */
 	palloc_free_page (file_name);
+
+	// so if we successfully load the process lets update their parent process
+	// depending on the successful load of a process we will return a difference status
+	// bless ternary operators!!!
+	// this wakes the parent up, after which INFO is gone
+	t->process->process_status = success ? LOAD_COMPLETE : LOAD_FAILED;
+	sema_up (&t->process->sema_initialization);
+
+	/* If load failed, quit. */
 	if (!success) 
 	{
 		// if thread fails
-		thread_current()->exit_code = -1;
+		t->exit_code = -1;
 		thread_exit ();
 	}
-	
-	// so if we successfully load the process lets update their parent process
-	// pass in the current thread
-	// depending on the successful load of a process we will return a difference status
-	// bless ternary operators!!!
-	update_parent_process_status(thread_current(), success ? LOAD_COMPLETE : LOAD_FAILED);
 
   /* Start the user process by simulating a return from an
      interrupt, implemented by intr_exit (in
@@ -160,6 +232,101 @@ start_process (void *file_name_)
 	NOT_REACHED ();
 }
 
+// handed from a forking process to the first function its child runs
+struct fork_info
+{
+	struct intr_frame frame;				// the parent's registers at the fork system call
+	uint32_t *pagedir;						// copy-on-write copy of the parent's page directory
+	struct thread *parent;					// the forking thread
+	struct process *process;				// the parent's entry for the child
+	struct semaphore done;					// upped once the child no longer needs this struct
+	bool success;							// whether the child got going
+};
+
+// creates a child of the current process that resumes from interrupt frame F with a copy
+// of the parent's address space and open files, and returns its thread id, or TID_ERROR.
+// no user memory is copied here: both processes share every page read-only until one of
+// them writes to it, see pagedir_fork and the copy-on-write case in page_fault
+tid_t process_fork (struct intr_frame *f)
+{
+	struct thread *cur = thread_current ();
+	struct fork_info info;
+	struct process *p;
+	tid_t tid;
+
+	info.frame = *f;
+	info.parent = cur;
+	info.success = false;
+	sema_init (&info.done, 0);
+
+	// link the child's entry before it can run, as process_execute does, so its exit
+	// status always has somewhere to go
+	p = process_create (TID_ERROR);
+	if (p == NULL)
+		return TID_ERROR;
+	list_push_back (&cur->children, &p->elem);
+	info.process = p;
+
+	info.pagedir = pagedir_fork (cur->pagedir);
+	if (info.pagedir == NULL)
+	{
+		release_child (p);
+		return TID_ERROR;
+	}
+
+	tid = thread_create (cur->name, PRI_DEFAULT, start_fork, &info);
+	if (tid == TID_ERROR)
+	{
+		pagedir_destroy (info.pagedir);
+		release_child (p);
+		return TID_ERROR;
+	}
+	p->pid = (pid_t) tid;
+
+	// INFO lives on our stack, so wait for the child to be done with it. if the child
+	// failed, it has already destroyed the page directory on its way out
+	sema_down (&info.done);
+	if (!info.success)
+	{
+		release_child (p);
+		return TID_ERROR;
+	}
+
+	// the child is already running, so there is nothing left to load
+	p->process_status = LOAD_COMPLETE;
+	return tid;
+}
+
+// thread function of a forked child: adopts the page directory prepared by process_fork,
+// copies the parent's open files and returns to user mode with fork's result of 0
+static void start_fork (void *info_)
+{
+	struct fork_info *info = info_;
+	struct thread *t = thread_current ();
+	struct intr_frame if_ = info->frame;
+	bool success;
+
+	t->process = info->process;
+	t->process->thread = t;
+	t->pagedir = info->pagedir;
+	t->heap_start = info->parent->heap_start;
+	t->heap_brk = info->parent->heap_brk;
+	process_activate ();
+
+	success = info->success = (copy_segments (info->parent)
+	                           && copy_file_descriptors (info->parent));
+	sema_up (&info->done);
+	if (!success)
+	{
+		t->exit_code = -1;
+		thread_exit ();
+	}
+
+	if_.eax = 0;
+	asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+	NOT_REACHED ();
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -170,7 +337,7 @@ start_process (void *file_name_)
    This function will be implemented in problem 2-2.  For now, it
    does nothing. */
 int
-process_wait (tid_t child_tid UNUSED) 
+process_wait (tid_t child_tid) 
 {
     // FIXME: @bgaster --- quick hack to make sure processes execute!
   	//for(;;) ;
@@ -204,17 +371,15 @@ process_wait (tid_t child_tid UNUSED)
 	// mark it as being waited for
 	p->waiting = true;
 
-	// wait for process to exit if it hasn't already
-	exit_status = p->exit_status;
-
 	if(DebugLogs) // debug log
 		printf("process_wait*( child_tid = %d ) -> invoked.\n", (int)child_tid);
+
+	// wait for process to exit if it hasn't already
+	sema_down (&p->sema_wait);
+	exit_status = p->exit_status;
 	
 	// remove child process now that it's done with
-	list_remove (&p->elem);
-	
-	//Frees block P, which must have been previously allocated with malloc(), calloc(), or realloc().
-	free (p);
+	release_child (p);
 
 	// return the exit status
 	return exit_status;
@@ -227,27 +392,26 @@ void
 process_exit (void)
 {
 	struct thread *cur = thread_current ();
+	enum intr_level old_level;
 	uint32_t *pd;
 
-	/* 
-	
-		SOME SORT OF CODE IMPLMENTATION NEEDS TO GO IN HERE
-		TO TERMINATE CHILD PROCESSES
-	
-	*/
+	// hand our exit status to our parent's entry for us, if the parent is still around.
+	// interrupts are off so the parent cannot free the entry halfway, see release_child
+	old_level = intr_disable ();
+	if (cur->process != NULL)
+	{
+		cur->process->exit_status = cur->exit_code;
+		cur->process->running = false;
+		cur->process->thread = NULL;
+		sema_up (&cur->process->sema_wait);
+		cur->process = NULL;
+	}
+	intr_set_level (old_level);
 	
 	/* Deallocating each child process' memory
      from children's list */
 	while(!list_empty(&cur->children))
-	{
-		struct list_elem * e = list_pop_front(&cur->children);
-		struct process * p = list_entry(e,struct process,elem);
-		list_remove(e);
-		free(p);
-	}
-	
-	// assign the thread exit code to the structure
-	cur->exit_code = thread_exitcode();
+		release_child (list_entry (list_front (&cur->children), struct process, elem));
 
 	/* Destroy the current process's page directory and switch back
 	to the kernel-only page directory. */
@@ -267,13 +431,30 @@ process_exit (void)
 		pagedir_destroy (pd);
 
 		/* get current name */
-		printf("%s: exit(0)\n",cur->name);
+		printf("%s: exit(%d)\n",cur->name, cur->exit_code);
+	}
+
+	// forget the lazily mapped segments and let the executable be written again
+	while (!list_empty (&cur->segments))
+		free (list_entry (list_pop_front (&cur->segments), struct segment, elem));
+	if (cur->executable != NULL)
+	{
+		bool fs = syscall_fs_lock ();
+		file_close (cur->executable);
+		syscall_fs_unlock (fs);
+		cur->executable = NULL;
 	}
 }
 
 /* Sets up the CPU for running user code in the current
    thread.
-   This function is called on every context switch. */
+   This function is called on every context switch.  Kernel
+   threads never enter user mode, so they just keep whatever page
+   directory and kernel stack pointer were loaded last: kernel
+   mappings are the same in every page directory.  A process that
+   finds its own page directory still loaded, because only kernel
+   threads (or nothing) ran since it last did, keeps its TLB
+   entries too. */
 void
 process_activate (void)
 {
@@ -284,8 +465,20 @@ process_activate (void)
 	/* say the thread has sucessfully loaded */
 	t->is_child_loaded = true;
 
+	if (t->pagedir == NULL)
+	{
+		lazy_switches++;
+		return;
+	}
+
 	/* Activate thread's page tables. */
-	pagedir_activate (t->pagedir);
+	if (pagedir_is_active (t->pagedir))
+		cr3_skips++;
+	else
+	{
+		pagedir_activate (t->pagedir);
+		cr3_loads++;
+	}
 
 	/* Set thread's kernel stack for use in processing
 	 interrupts. */
@@ -373,6 +566,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
   struct file *file = NULL;
   off_t file_ofs;
   bool success = false;
+  uint32_t data_end = 0;
   int i;
 
 	char file_name_copy[100];   
@@ -397,6 +591,11 @@ load (const char *file_name, void (**eip) (void), void **esp)
     goto done;
   process_activate ();
 
+  /* Map the time page first, so that no segment can take its
+     place. */
+  if (!install_time_page ())
+    goto done;
+
 	printf("load -> argv[0] = %s\n", argv[0]);
 	
   /* Open executable file. */
@@ -473,6 +672,8 @@ load (const char *file_name, void (**eip) (void), void **esp)
               if (!load_segment (file, file_page, (void *) mem_page,
                                  read_bytes, zero_bytes, writable))
                 goto done;
+              if (mem_page + read_bytes + zero_bytes > data_end)
+                data_end = mem_page + read_bytes + zero_bytes;
             }
           else
             goto done;
@@ -480,6 +681,9 @@ load (const char *file_name, void (**eip) (void), void **esp)
         }
     }
 
+  /* The heap starts empty on the page after the last segment. */
+  t->heap_start = t->heap_brk = (uint8_t *) data_end;
+
   /* Set up stack. */
   if (!setup_stack (esp, argv, argc))
     goto done;
@@ -490,14 +694,24 @@ load (const char *file_name, void (**eip) (void), void **esp)
   success = true;
 
  done:
-  /* We arrive here whether the load is successful or not. */
-  file_close (file);
+  /* We arrive here whether the load is successful or not.  The
+     read-only segments are read from the executable as they are
+     touched, so on success it stays open, and unwritable, until
+     the process exits. */
+  if (success)
+    {
+      file_deny_write (file);
+      t->executable = file;
+    }
+  else
+    file_close (file);
   return success;
 }
 
 /* load() helpers. */
 
 static bool install_page (void *upage, void *kpage, bool writable);
+static bool install_zero_page (void *upage, bool writable);
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -555,6 +769,9 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
 
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
+   Read-only segments are not read here: their pages are mapped
+   when first touched, and shared with other processes running
+   the same executable; see process_text_fault().
 
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
@@ -566,7 +783,19 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
-  file_seek (file, ofs);
+  if (!writable)
+    {
+      struct segment *seg = malloc (sizeof *seg);
+      if (seg == NULL)
+        return false;
+      seg->upage = upage;
+      seg->page_cnt = (read_bytes + zero_bytes) / PGSIZE;
+      seg->ofs = ofs;
+      seg->read_bytes = read_bytes;
+      list_push_back (&thread_current ()->segments, &seg->elem);
+      return true;
+    }
+
   while (read_bytes > 0 || zero_bytes > 0) 
     {
       /* Calculate how to fill this page.
@@ -574,30 +803,43 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
          and zero the final PAGE_ZERO_BYTES bytes. */
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
+      uint8_t *kpage;
 
-      /* Get a page of memory. */
-      uint8_t *kpage = palloc_get_page (PAL_USER);
-      if (kpage == NULL)
-        return false;
-
-      /* Load this page. */
-      if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes)
+      if (page_read_bytes == 0)
         {
-          palloc_free_page (kpage);
-          return false; 
+          /* Pages of nothing but zeros, such as most of BSS,
+             take no memory until they are written. */
+          if (!install_zero_page (upage, writable))
+            return false;
         }
-      memset (kpage + page_read_bytes, 0, page_zero_bytes);
-
-      /* Add the page to the process's address space. */
-      if (!install_page (upage, kpage, writable)) 
+      else
         {
-          palloc_free_page (kpage);
-          return false; 
+          /* Get a page of memory. */
+          kpage = frame_get_page (0);
+          if (kpage == NULL)
+            return false;
+
+          /* Load this page. */
+          if (file_read_at (file, kpage, page_read_bytes, ofs)
+              != (int) page_read_bytes)
+            {
+              frame_put_page (kpage);
+              return false; 
+            }
+          memset (kpage + page_read_bytes, 0, page_zero_bytes);
+
+          /* Add the page to the process's address space. */
+          if (!install_page (upage, kpage, writable)) 
+            {
+              frame_put_page (kpage);
+              return false; 
+            }
         }
 
       /* Advance. */
       read_bytes -= page_read_bytes;
       zero_bytes -= page_zero_bytes;
+      ofs += PGSIZE;
       upage += PGSIZE;
     }
   return true;
@@ -616,7 +858,7 @@ setup_stack (void **esp,  char **argv, int argc)
 	// obtain a single free page to return its kernal virtual address
 	// PAL_USER is set so the page is obtained from the user pool
 	// PAL_ZERO is set so the page is filled with zeros
-	kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+	kpage = frame_get_page (PAL_ZERO);
 	
 	// we check for kpage just in case because if there are no pages
 	// then we recieve a null pointer
@@ -677,7 +919,7 @@ setup_stack (void **esp,  char **argv, int argc)
 		} 
 		else
 		{
-			palloc_free_page (kpage);
+			frame_put_page (kpage);
 		}
         
     }
@@ -693,8 +935,8 @@ setup_stack (void **esp,  char **argv, int argc)
    If WRITABLE is true, the user process may modify the page;
    otherwise, it is read-only.
    UPAGE must not already be mapped.
-   KPAGE should probably be a page obtained from the user pool
-   with palloc_get_page().
+   KPAGE must be a frame obtained with frame_get_page(); the
+   mapping takes over the caller's reference to it.
    Returns true on success, false if UPAGE is already mapped or
    if memory allocation fails. */
 static bool
@@ -708,6 +950,230 @@ install_page (void *upage, void *kpage, bool writable)
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
 
+/* Maps the time page read-only at TIME_PAGE_ADDR.  fork() shares
+   it with the child like any other read-only page.
+   Returns true on success, false if memory allocation fails. */
+static bool
+install_time_page (void)
+{
+  frame_share (time_kpage);
+  if (install_page ((void *) TIME_PAGE_ADDR, time_kpage, false))
+    return true;
+  frame_put_page (time_kpage);
+  return false;
+}
+
+/* Maps the shared zero frame at user virtual address UPAGE.  If
+   WRITABLE is true, the first write to UPAGE replaces it by a
+   private zeroed frame; otherwise UPAGE is read-only.
+   UPAGE must not already be mapped.
+   Returns true on success, false if UPAGE is already mapped or
+   if memory allocation fails. */
+static bool
+install_zero_page (void *upage, bool writable)
+{
+  struct thread *t = thread_current ();
+  void *kpage = frame_get_zero_page ();
+  bool success;
+
+  if (pagedir_get_page (t->pagedir, upage) != NULL)
+    success = false;
+  else if (writable)
+    success = pagedir_set_page_cow (t->pagedir, upage, kpage);
+  else
+    success = pagedir_set_page (t->pagedir, upage, kpage, false);
+
+  if (!success)
+    frame_put_page (kpage);
+  return success;
+}
+
+// moves the current process's program break by INCREMENT bytes and returns the old break,
+// or (void *) -1 if that would take the heap below its start or into the stack's space.
+// pages are only mapped when first touched, see process_heap_fault; pages wholly above a
+// lowered break are unmapped and freed straight away
+void *process_sbrk (intptr_t increment)
+{
+	struct thread *t = thread_current ();
+	uint8_t *old_brk = t->heap_brk;
+	uint8_t *new_brk = old_brk + increment;
+	uint8_t *page;
+
+	// refuse to wrap around, to run into the stack's space or to drop below the heap's start
+	if (increment > 0 && (new_brk < old_brk || new_brk > (uint8_t *) PHYS_BASE - STACK_RESERVE))
+		return (void *) -1;
+	if (increment < 0 && (new_brk > old_brk || new_brk < t->heap_start))
+		return (void *) -1;
+
+	// give back every page that now lies entirely above the break
+	for (page = pg_round_up (new_brk); page < old_brk; page += PGSIZE)
+		pagedir_drop_page (t->pagedir, page);
+
+	t->heap_brk = new_brk;
+	return old_brk;
+}
+
+// called when UADDR is not mapped. if it lies inside the current process's heap, maps
+// a page there and returns true, otherwise returns false. a page that is only being read
+// gets the shared zero frame, so it takes no memory until it is first written
+static bool process_heap_fault (void *uaddr, bool write)
+{
+	struct thread *t = thread_current ();
+	uint8_t *upage = pg_round_down (uaddr);
+	void *kpage;
+
+	if ((uint8_t *) uaddr < t->heap_start || (uint8_t *) uaddr >= t->heap_brk)
+		return false;
+
+	if (!write)
+		return install_zero_page (upage, true);
+
+	kpage = frame_get_page (PAL_ZERO);
+	if (kpage == NULL)
+		return false;
+	if (!install_page (upage, kpage, true))
+	{
+		frame_put_page (kpage);
+		return false;
+	}
+	return true;
+}
+
+// returns true if UPAGE in PD is mapped or swapped out, so that fault-around must leave it alone
+static bool page_taken (uint32_t *pd, void *upage)
+{
+	return pagedir_get_page (pd, upage) != NULL || pagedir_is_swapped (pd, upage);
+}
+
+// called when UADDR is not mapped. if it lies inside one of the current process's read-only
+// segments, maps it and returns true, otherwise returns false. pages are read in windows of
+// fault_around_pages, so that starting a big program takes a handful of faults rather than
+// one per page: every page in the window around UADDR that is not mapped yet gets mapped,
+// pages other processes already have in memory are shared, and each run of the others is
+// read from the executable at once
+static bool process_text_fault (void *uaddr)
+{
+	struct thread *t = thread_current ();
+	uint8_t *upage = pg_round_down (uaddr);
+	void *kpages[FAULT_AROUND_MAX];
+	struct segment *seg = NULL;
+	struct list_elem *e;
+	size_t window, idx, first, last, i;
+	bool success = false;
+
+	for (e = list_begin (&t->segments); e != list_end (&t->segments); e = list_next (e))
+	{
+		struct segment *s = list_entry (e, struct segment, elem);
+		if (upage >= s->upage && upage < s->upage + s->page_cnt * PGSIZE)
+		{
+			seg = s;
+			break;
+		}
+	}
+	if (seg == NULL)
+		return false;
+
+	// the window is aligned to its own size, so neighbouring faults don't overlap
+	window = fault_around_pages < 1 ? 1 : fault_around_pages;
+	if (window > FAULT_AROUND_MAX)
+		window = FAULT_AROUND_MAX;
+	idx = (upage - seg->upage) / PGSIZE;
+	first = idx - idx % window;
+	last = first + window < seg->page_cnt ? first + window : seg->page_cnt;
+
+	text_faults++;
+	for (i = first; i < last; )
+	{
+		size_t run_end, run_bytes, j;
+
+		// skip pages an earlier fault already mapped, and ones zswap has since evicted
+		if (page_taken (t->pagedir, seg->upage + i * PGSIZE))
+		{
+			i++;
+			continue;
+		}
+		for (run_end = i + 1; run_end < last; run_end++)
+			if (page_taken (t->pagedir, seg->upage + run_end * PGSIZE))
+				break;
+
+		// bytes of file data in pages I through RUN_END - 1
+		run_bytes = 0;
+		if (seg->read_bytes > i * PGSIZE)
+			run_bytes = seg->read_bytes - i * PGSIZE;
+		if (run_bytes > (run_end - i) * PGSIZE)
+			run_bytes = (run_end - i) * PGSIZE;
+
+		frame_get_text_pages (t->executable, seg->ofs + i * PGSIZE, run_bytes,
+		                      run_end - i, kpages);
+		for (j = i; j < run_end; j++)
+		{
+			void *kpage = kpages[j - i];
+			if (kpage == NULL)
+				continue;
+			if (!install_page (seg->upage + j * PGSIZE, kpage, false))
+			{
+				frame_put_page (kpage);
+				continue;
+			}
+			text_pages_mapped++;
+			if (j == idx)
+				success = true;
+		}
+		i = run_end;
+	}
+	return success;
+}
+
+// called when UADDR, a user address, is not mapped. brings the page back in if it was
+// swapped out, or else maps it if it belongs to the heap or to a read-only segment.
+// returns false if UADDR is not part of the process at all, or if memory runs out
+bool process_fault (void *uaddr, bool write)
+{
+#ifdef VM
+	if (zswap_fault (thread_current ()->pagedir, pg_round_down (uaddr)))
+		return true;
+#endif
+	return process_heap_fault (uaddr, write) || process_text_fault (uaddr);
+}
+
+// gives the current thread a copy of FROM's executable and read-only segments, for fork
+static bool copy_segments (struct thread *from)
+{
+	struct thread *t = thread_current ();
+	struct list_elem *e;
+	bool fs;
+
+	if (from->executable != NULL)
+	{
+		fs = syscall_fs_lock ();
+		t->executable = file_reopen (from->executable);
+		if (t->executable != NULL)
+			file_deny_write (t->executable);
+		syscall_fs_unlock (fs);
+		if (t->executable == NULL)
+			return false;
+	}
+
+	for (e = list_begin (&from->segments); e != list_end (&from->segments); e = list_next (e))
+	{
+		struct segment *seg = malloc (sizeof *seg);
+		if (seg == NULL)
+			return false;
+		*seg = *list_entry (e, struct segment, elem);
+		list_push_back (&t->segments, &seg->elem);
+	}
+	return true;
+}
+
+// prints statistics about faults on read-only segments
+void process_print_stats (void)
+{
+	printf ("Text: %llu faults mapped %llu pages (window %zu)\n",
+	        text_faults, text_pages_mapped, fault_around_pages);
+	printf ("Switch: %llu to kernel threads, %llu CR3 loads, %llu skipped\n",
+	        lazy_switches, cr3_loads, cr3_skips);
+}
+
 // this function creates a pointer to a struct when called
 struct process *process_create (tid_t tid) // we accept a thread id
 {
@@ -719,7 +1185,7 @@ struct process *process_create (tid_t tid) // we accept a thread id
 	}
 	
 	// we request to allocate memory for our struct and get a pointer
-  	struct process *p_ptr = malloc (sizeof (struct process));
+  	struct process *p_ptr = slab_alloc (process_cache);
 
 	// null check the pointer
 	if (p_ptr == NULL)
@@ -745,9 +1211,9 @@ struct process *process_create (tid_t tid) // we accept a thread id
 	// set thread status variables
 	p_ptr->running = true;
 	p_ptr->waiting = false;
-	
-	// initialize list elem on the process
-	list_init(&p_ptr->elem);
+	p_ptr->exit_status = -1;
+	sema_init (&p_ptr->sema_wait, 0);
+	sema_init (&p_ptr->sema_initialization, 0);
 
 	// return struct pointer
   	return p_ptr;
@@ -780,38 +1246,36 @@ struct process *get_child_process (struct thread *t, tid_t thread_id)
 		return NULL;
 	}
 		
-	//if(DebugLogs) // debug log
-		//printf("\nITERATION LIST DEBUG:\n\n");
-	
-	// null check next elem in the list
-	/*if(is_head(e) != NULL)
+	// for every element within the threads children
+	for (e = list_begin (&t->children); e != list_end (&t->children); e = list_next (e))
 	{
-		// for every element within the threads children
-		for (e = list_begin (&t->children); e != list_end (&t->children);e = list_next (e))
-		{
-
-			//if(is_head(e) != NULL)
-			//{
-				// get the process struct
-				p = list_entry (e, struct process, elem);
+		// get the process struct
+		p = list_entry (e, struct process, elem);
 
-				//if(DebugLogs) // debug log
-					//printf("ids %d == %d\n", (pid_t)p->pid, (int)thread_id);
+		// we need to check if the target child thread id is the same as the process id
+		if (p->pid == (pid_t) thread_id)
+			return p; // if so return it
+	}
 
-				// we need to check if the target child thread id is the same as the process id
-				if (p->pid == (pid_t) thread_id)
-					return p; // if so return it
-			//}
+	// if we could not find our process id return null it has no child processes
+	return NULL;
+}
 
-		}
+// unlinks child entry P from the current thread's children and frees it. a child that is
+// still running is told to forget it first, with interrupts off so that it cannot be
+// halfway through reporting its exit status, see process_exit
+static void release_child (struct process *p)
+{
+	enum intr_level old_level;
 
-	}*/
-	
-	//if(DebugLogs) // debug log
-		//printf("\n\nITERATION LIST DEBUG END\n\n");
+	old_level = intr_disable ();
+	if (p->thread != NULL)
+		p->thread->process = NULL;
+	list_remove (&p->elem);
+	intr_set_level (old_level);
 
-	// if we could not find our process id return null it has no child processes
-	return NULL;
+	// give P back to the cache it was allocated from in process_create
+	slab_free (process_cache, p);
 }
 
 // called when we want to update a parent process status given a thread and process_status
@@ -1,12 +1,21 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include "threads/interrupt.h"
 #include "threads/thread.h"
 
+void process_init (void);
 tid_t process_execute (const char *file_name);
+tid_t process_fork (struct intr_frame *);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
+void *process_sbrk (intptr_t increment);
+bool process_fault (void *uaddr, bool write);
+void process_print_stats (void);
+
+/* Pages mapped per fault on a read-only segment. */
+extern size_t fault_around_pages;
 
 
 // enum for process status
@@ -25,6 +34,7 @@ struct process
 {
 	struct list_elem elem;					// List element for child processes list.
 	pid_t pid;                    			// process id
+	struct thread *thread;					// the child's thread while it runs, else NULL
 	bool running;                				// to determine if the process is still running
 	bool waiting;							// to determine if the process is waiting
 	int exit_status;                		// exit status code of the process
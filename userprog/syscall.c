@@ -1,19 +1,27 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
 #include <syscall-nr.h>
+#include <syscall-ring.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
 #include "process.h"
 
+#include "threads/palloc.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
+#include "threads/slab.h"
+#include "threads/cpu.h"
+#include "threads/loader.h"
+#include "userprog/uaccess.h"
+#include "userprog/sysenter.h"
+#include "userprog/tss.h"
 
 #include "filesys/filesys.h"
+#include "filesys/file.h"
 
 int grabFromStack(struct intr_frame *f UNUSED, int pos);
 void syscall_init (void);
-bool IsValidVAddress(void * vaddress);
 
 void halt(void);
 void exit(int status);
@@ -30,13 +38,25 @@ unsigned tell(int fd);
 void close_via_fd (int fd);
 
 void throw_not_implemented_message_and_terminate_thread(int syscallnum);
-static void syscall_handler (struct intr_frame *);
+
+// model-specific registers that SYSENTER loads the kernel's code segment, stack pointer and
+// entry point from. see [IA32-v3a] 5.8.7 "Performing Fast Calls to System Procedures"
+#define MSR_SYSENTER_CS 0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+// entry point of the SYSENTER path, in sysenter.S
+void sysenter_entry(void);
+static void sysenter_init(void);
 
 // create a new lock struct for locking threads/synchronization
 struct lock syscall_lock;
 
+// object cache that every struct file_desc is allocated from
+static struct slab_cache *file_desc_cache;
+
 // decides if we want to show debug logs
-bool debug = true;
+bool debug = false;
 
 // called on syscall initialize
 void syscall_init (void) 
@@ -44,24 +64,96 @@ void syscall_init (void)
 	// initialize lock or syscall_lock
 	lock_init(&syscall_lock);
 
+	// create the cache for file descriptors handed out by open
+	file_desc_cache = slab_cache_create ("file_desc", sizeof (struct file_desc), NULL);
+
 	// init register
   	intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");	
+
+	// processes may also come in through the cheaper SYSENTER instruction, if there is one
+	if(cpu_features() & CPUID_SEP)
+		sysenter_init();
+}
+
+// points the SYSENTER instruction at sysenter_entry. SYSENTER does not switch stacks the way an
+// interrupt does, so its stack pointer is the address of the TSS's esp0 member, which always
+// holds the top of the running process's kernel stack, and sysenter_entry loads the real
+// stack pointer from there
+static void sysenter_init(void)
+{
+	wrmsr(MSR_SYSENTER_CS, SEL_KCSEG);
+	wrmsr(MSR_SYSENTER_ESP, (uint32_t) tss_get_esp0());
+	wrmsr(MSR_SYSENTER_EIP, (uint32_t) sysenter_entry);
 }
 
 /* 
 	Memory Validation Functions
+
+	user memory is only ever touched through the routines in uaccess.h, which fail instead of
+	crashing the kernel when the process hands us a bad pointer. there is nothing to check up
+	front, so a good pointer costs no more than the copy itself
 */
 
-// called when we want to check if a virtual address is valid
-bool IsValidVAddress(void * vaddress)
+// copies the CNT argument words of the current system call into ARGS. "int $0x30" callers
+// push them onto the user stack after the system call number; a process whose stack pointer
+// is bad is killed. SYSENTER callers pass them in EBX, ESI and EDI, so there is nothing to copy
+static void get_args(struct intr_frame *f, uint32_t *args, int cnt)
 {
-	// get the current thread
-	struct thread *cur = thread_current();
-	
-	// invoke the is_user_vaddr in vaddr.h which checks if address is less than PHYS_BASE
-	// invoke pagedir_get_page to return the physical address of the virtual address
-	// e.g the current threads pagedir. Check for null pointer if the UADDR is unmapped
-	return (is_user_vaddr(vaddress) && pagedir_get_page(cur->pagedir,vaddress));
+	if(f->vec_no == SYSENTER_VEC_NO)
+	{
+		uint32_t regs[3] = { f->ebx, f->esi, f->edi };
+		int i;
+
+		for(i = 0; i < cnt; i++)
+			args[i] = regs[i];
+		return;
+	}
+	if(!copy_from_user(args, (uint32_t *) f->esp + 1, cnt * sizeof *args))
+	{
+		if(debug)
+			printf( "Pointers not valid exiting thread :: kernal violation...\n" );
+		exit(-1);
+	}
+}
+
+// copies the string at user address USTR into a new page, which the caller must free with
+// palloc_free_page. a process that passes a bad pointer is killed; a string that does not
+// fit in a page, or no memory for the page, gives a null pointer
+static char *get_string(const char *ustr)
+{
+	char *kstr = palloc_get_page(0);
+	int length;
+
+	if(kstr == NULL)
+		return NULL;
+
+	length = strncpy_from_user(kstr, ustr, PGSIZE);
+	if(length < 0)
+	{
+		palloc_free_page(kstr);
+		if(debug)
+			printf( "Pointers not valid exiting thread :: kernal violation...\n" );
+		exit(-1);
+	}
+	if(length == PGSIZE)
+	{
+		palloc_free_page(kstr);
+		return NULL;
+	}
+	return kstr;
+}
+
+// kills the process unless it may read the SIZE bytes at UBUF, and write them too if
+// WRITABLE. afterwards the kernel can read or write the buffer in place, however many pages
+// it spans
+static void check_buffer(void *ubuf, unsigned size, bool writable)
+{
+	if(!check_user_buffer(ubuf, size, writable))
+	{
+		if(debug)
+			printf( "Pointers not valid exiting thread :: kernal violation...\n" );
+		exit(-1);
+	}
 }
 
 /* 
@@ -252,7 +344,7 @@ int open(const char* filename)
     */
 
 	// allocate memory for the file descriptor
-	struct file_desc * fd_elem = malloc(sizeof(struct file_desc));
+	struct file_desc * fd_elem = slab_alloc(file_desc_cache);
 
 	// if we open the same file at a different time we make sure the file descriptor is different
 	fd_elem->fd = ++thread_current()->fd_count;
@@ -506,11 +598,66 @@ void close_via_fd (int fd)
 	// remove the file descriptor from the list elem
   	list_remove(&file_descriptor->elem);
 	
-	// remove file_descriptor from memory with free because we used malloc to assigned it in memory
-  	free(file_descriptor);
+	// give file_descriptor back to the cache it was allocated from in open
+  	slab_free(file_desc_cache, file_descriptor);
 	
 }
 
+// gives the current thread its own copy of every file FROM has open, under the same fd
+// numbers. used by fork; each copy has its own position, starting where FROM's is now
+bool copy_file_descriptors (struct thread *from)
+{
+	struct thread *cur = thread_current();
+	struct list_elem *e;
+
+	for (e = list_begin(&from->file_list); e != list_end(&from->file_list); e = list_next(e))
+	{
+		struct file_desc *parent_fd = list_entry(e, struct file_desc, elem);
+		struct file_desc *fd_elem = slab_alloc(file_desc_cache);
+
+		if (fd_elem == NULL)
+			return false;
+
+		lock_acquire(&syscall_lock);
+		fd_elem->fp = file_reopen(parent_fd->fp);
+		if (fd_elem->fp != NULL)
+			file_seek(fd_elem->fp, file_tell(parent_fd->fp));
+		lock_release(&syscall_lock);
+
+		if (fd_elem->fp == NULL)
+		{
+			slab_free(file_desc_cache, fd_elem);
+			return false;
+		}
+
+		// keep the parent's order so lookups behave the same in both processes
+		fd_elem->fd = parent_fd->fd;
+		list_push_back(&cur->file_list, &fd_elem->elem);
+	}
+
+	cur->fd_count = from->fd_count;
+	return true;
+}
+
+// takes syscall_lock for file system work done outside a system call, such as reading a
+// text page on a fault or closing the executable at exit, so that it cannot race with
+// system calls. a caller that already holds the lock, e.g. one killed halfway through a
+// system call, keeps it. returns whether the lock was taken, to hand to syscall_fs_unlock
+bool syscall_fs_lock(void)
+{
+	if (lock_held_by_current_thread(&syscall_lock))
+		return false;
+	lock_acquire(&syscall_lock);
+	return true;
+}
+
+// releases syscall_lock if syscall_fs_lock took it
+void syscall_fs_unlock(bool taken)
+{
+	if (taken)
+		lock_release(&syscall_lock);
+}
+
 // called when a sys call is not implemented
 void throw_not_implemented_message_and_terminate_thread(int syscallnum)
 {
@@ -522,343 +669,299 @@ void throw_not_implemented_message_and_terminate_thread(int syscallnum)
 	thread_exit();
 }
 	
-static void
-syscall_handler (struct intr_frame *f UNUSED)
+/* 
+	System call table
+
+	every system call is described by an entry in syscall_table, indexed by its number: the
+	function that carries it out, how many argument words it takes and what each of them is.
+	the dispatcher fetches and checks the arguments once, up front, the same way for every call,
+	so adding a system call means writing its function and its table entry and nothing else
+*/
+
+// what an argument word is, and so what the dispatcher does with it before the call
+enum syscall_arg
 {
-	// get the syscall number int or enum stored in the stack pointer
-	//uint32_t *syscall_number = f->esp;
-	int syscall_number = *(int*)f->esp;
-	
-	// debug log
-    //if(debug)
-	    //printf( "syscall_handler -> invoked syscall_number = %d\n", syscall_number );
-	
-	// handle the enum via switch statement
-	switch(syscall_number)
-	{
-		case SYS_HALT: // invoked on system halt
-			
-			// debug log
-            if(debug)
-			    printf( "SYS_HALT called!\n" );
-			
-			// invoke the local procedure in this syscall.c named halt
-			halt();
-			
-			break;
-		case SYS_EXIT: // invoked on system exit
-			
-			// debug log
-            if(debug)
-			    printf( "SYS_EXIT called!\n" );
-			
-			// get the status of a thread from the stack
-			int status = *((int*)f->esp + 1);
-			
-			// invoke the local exit procedure in this syscall.c with the status int
-			exit(status);
-			
-			break;
-		
-		case SYS_EXEC:
-			
-			// debug log
-			if(debug)
-				printf( "SYS_EXEC called!\n" );
-
-			// validate memory
-			// invalid pointers must be rejected without harm to the kernel or other running processes
-			if(!IsValidVAddress(f->esp + 1)) // 1
-			{
-				if(debug)
-					printf( "Pointers not valid exiting thread :: kernal violation...\n" );
-				
-				// if any IsValidVAddress returns false
-				// halt code here as the thread will be terminated
-				exit(-1); // is invoked because why continue if we have bad memory here
-				return;
-			}
-			
-			// get the command line pointer from the stack
-			const char* cmdline = ((char*) *((int*)f->esp + 1)); // 1
-			
-            // execute program and get the processID
-			// set the EAX register :: System calls that return a value can do so
-			// by modifying the eax member of struct intr_frame
-			f->eax = exec(cmdline);
-			
-			break;
-		case SYS_WAIT:
+	ARG_WORD,		// a plain value, passed on as it is
+	ARG_STRING,		// a user string, passed on as a copy in a kernel page, or NULL if too long
+	ARG_BUF_IN,		// a user buffer the kernel reads; the next argument is its size
+	ARG_BUF_OUT		// a user buffer the kernel writes; the next argument is its size
+};
 
-			// debug log
-			if(debug)
-				printf( "SYS_WAIT called!\n" );
-			
-			// validate memory
-			// invalid pointers must be rejected without harm to the kernel or other running processes
-			if(!IsValidVAddress(f->esp + 1)) // f->esp + 1
-			{
-				if(debug)
-					printf( "Pointers not valid exiting thread :: kernal violation...\n" );
-				
-				// if any IsValidVAddress returns false
-				// halt code here as the thread will be terminated
-				exit(-1); // is invoked because why continue if we have bad memory here
-				return;
-			}
-
-			// invoke syscall wait
-			// set the EAX register :: System calls that return a value can do so
-			f->eax = wait(*((int*)f->esp + 1)); // *((int*)f->esp + 1)
-			
-			break;
-		case SYS_CREATE:
-			
-			// debug log
-            if(debug)
-			    printf( "SYS_CREATE called!\n" );
-			
-			// validate memory
-			// invalid pointers must be rejected without harm to the kernel or other running processes
-			if(!IsValidVAddress(f->esp + 4) || !IsValidVAddress(f->esp + 5))
-			{
-				if(debug)
-					printf( "Pointers not valid exiting thread :: kernal violation...\n" );
-				
-				// if any IsValidVAddress returns false
-				// halt code here as the thread will be terminated
-				exit(-1); // is invoked because why continue if we have bad memory here
-				return;
-			}
-			
-            if(debug) // debug log
-			    printf( "Pointers validated proceeding...\n" );
-			
-			// get the file name and file size from the stack
-			char* filename = ((char*) *((int*)f->esp + 4));
-			unsigned filesize = ((unsigned *) *((int*)f->esp + 5));
-	
-			// set the EAX register :: System calls that return a value can do so
-			// by modifying the eax member of struct intr_frame
-			f->eax = create(filename, filesize);
-			
-			break;
-		case SYS_REMOVE:
-			
-			if(debug) // debug log 
-				printf("SYS_REMOVE called\n");
-			
-			// validate memory
-			// invalid pointers must be rejected without harm to the kernel or other running processes
-			if(!IsValidVAddress(f->esp + 1))
-			{
-				if(debug)
-					printf( "Pointers not valid exiting thread :: kernal violation...\n" );
-				
-				// if any IsValidVAddress returns false
-				// halt code here as the thread will be terminated
-				exit(-1); // is invoked because why continue if we have bad memory here
-				return;
-			}
-			
-			// Get the file name from the stack
-			char* fileName = ((char*) *((int*)f->esp + 1));
-			// Remove the file and save the result to
-			f->eax = remove_file(fileName);
-			break;
-		case SYS_OPEN:
-			
-            if(debug) // debug log 
-                printf( "SYS_OPEN -> start\n" );
-
-			// validate memory
-			// invalid pointers must be rejected without harm to the kernel or other running processes
-			if(!IsValidVAddress(f->esp + 1))
-			{
-				if(debug)
-					printf( "Pointers not valid exiting thread :: kernal violation...\n" );
-				
-				// if any IsValidVAddress returns false
-				// halt code here as the thread will be terminated
-				exit(-1); // is invoked because why continue if we have bad memory here
-				return;
-			}
-			
-			// get desired file to open name from the stack
-            // we assigned the the stack position to an int pointer and then void return pointer to a char
-			char* open_filename = ((char*) *((int*)f->esp + 1));
-			
-			if(debug)
-            	printf( "open_filename = %s\n", open_filename );
-			
-			// open file name
-			// set the EAX register :: System calls that return a value can do so
-			// by modifying the eax member of struct intr_frame
-			f->eax = open(open_filename);
-			
-			break;
-		case SYS_FILESIZE: // Chris has not responded so Charles has implemented it
-			
-			if(debug)
-				printf("SYS_FILESIZE called\n");
-
-			// validate memory
-			// invalid pointers must be rejected without harm to the kernel or other running processes
-			if(!IsValidVAddress(f->esp + 1))
-			{
-				if(debug)
-					printf( "Pointers not valid exiting thread :: kernal violation...\n" );
-				
-				// if any IsValidVAddress returns false
-				// halt code here as the thread will be terminated
-				exit(-1); // is invoked because why continue if we have bad memory here
-				return;
-			}
-			
-			// get file descriptor from the stack
-			// set the EAX register :: System calls that return a value can do so
-			// by modifying the eax member of struct intr_frame
-  			f->eax = get_filesize(*((int*)f->esp + 1));
+// carries out a system call with the fetched arguments ARGS. the return value goes back to the
+// process in EAX
+typedef uint32_t syscall_func(struct intr_frame *f, uint32_t *args);
 
-			break;
-		case SYS_READ:;// implemented by faegan
-			
-			//if(debug)
-				//printf("SYS_READ called\n");
-			
-			// validate memory
-			// invalid pointers must be rejected without harm to the kernel or other running processes
-			if(!IsValidVAddress(f->esp + 4) || !IsValidVAddress(f->esp + 8) || !IsValidVAddress(f->esp + 12))
-			{
-				if(debug)
-					printf( "Pointers not valid exiting thread :: kernal violation...\n" );
-				
-				// if any IsValidVAddress returns false
-				// halt code here as the thread will be terminated
-				exit(-1); // is invoked because why continue if we have bad memory here
-				return;
-			}
-			
-			// Get the file descriptor from the stack
-			int file_d = *(int *)(f->esp + 4);
-			
-			// Get the buffer from the stack
-			void *buff = *(char**)(f->esp + 8);
-			
-			// Set the size 
-			unsigned length = *(unsigned *)(f->esp + 12);
-			
-			// Read the file and save it to the eax register
-			f->eax = read(file_d, buff, length);
-			
-			break;
-		case SYS_WRITE:; // invoked on system write
-			
-			// validate memory
-			// invalid pointers must be rejected without harm to the kernel or other running processes
-			if(!IsValidVAddress(f->esp + 4) || !IsValidVAddress(f->esp + 8) || !IsValidVAddress(f->esp + 12))
-			{
-				if(debug)
-					printf( "Pointers not valid exiting thread :: kernal violation...\n" );
-				
-				// if any IsValidVAddress returns false
-				// halt code here as the thread will be terminated
-				exit(-1); // is invoked because why continue if we have bad memory here
-				return;
-			}
-			
-			// information reference https://www.quora.com/What-is-the-file-descriptor-What-are-STDIN_FILENO-STDOUT_FILENO-and-STDERR_FILENO
-			// get the file descriptor from the stack
-			int fd = *(int *)(f->esp + 4);
-			
-			// create a buffer
-			void *buffer = *(char**)(f->esp + 8);
-			
-			// size of buffer
-			unsigned size = *(unsigned *)(f->esp + 12);
+struct syscall
+{
+	const char *name;			// for debug logs and statistics
+	syscall_func *func;			// NULL if not implemented
+	int argc;				// number of argument words
+	enum syscall_arg kinds[3];		// what each argument word is
+	bool quiet;				// no debug log, for calls made too often to report
+};
+
+static uint32_t sys_halt(struct intr_frame *f UNUSED, uint32_t *args UNUSED)
+{
+	halt();
+	NOT_REACHED();
+}
 
-			// write to file
-			f->eax = write(fd, buffer, size);
+static uint32_t sys_exit(struct intr_frame *f UNUSED, uint32_t *args)
+{
+	exit((int) args[0]);
+	NOT_REACHED();
+}
 
-			break;
-		case SYS_SEEK:;
-			
-			if(debug)
-				printf("SYS_SEEK called\n");
-			
-			// invalid pointers must be rejected without harm to the kernel or other running processes
-			if(!IsValidVAddress(f->esp + 4) || !IsValidVAddress(f->esp + 5))
-			{
-				if(debug)
-					printf( "Pointers not valid exiting thread :: kernal violation...\n" );
-				
-				// if any IsValidVAddress returns false
-				// halt code here as the thread will be terminated
-				exit(-1); // is invoked because why continue if we have bad memory here
-				return;
-			}
-			
-			// get the file descriptor from the stack
-			int tfd = *(int *)(f->esp + 4);
-			
-			// posistion
-			unsigned pos = *(unsigned *)(f->esp + 5);
+static uint32_t sys_exec(struct intr_frame *f UNUSED, uint32_t *args)
+{
+	const char *cmd_line = (const char *) args[0];
+	return cmd_line != NULL ? exec(cmd_line) : TID_ERROR;
+}
 
-			// seek with file descriptor
-			seek(tfd, pos);
-			
-			break;
-		case SYS_TELL: // implemented by faegan
-
-			if(debug)
-				printf("SYS_TELL called\n");
-
-			// validate memory
-			// invalid pointers must be rejected without harm to the kernel or other running processes
-			if(!IsValidVAddress(f->esp + 4))
-			{
-				if(debug)
-					printf( "Pointers not valid exiting thread :: kernal violation...\n" );
-				
-				// if any IsValidVAddress returns false
-				// halt code here as the thread will be terminated
-				exit(-1); // is invoked because why continue if we have bad memory here
-				return;
-			}
-			
-			// Get the file descriptor value from the stack
-			fd = *(int *)(f->esp + 4);
-			// Get the position in the file from the file descriptor number and save it tot he eax register
-			f->eax = tell(fd);
-			// Break the switch statement
-			break;
-		case SYS_CLOSE:
-			
-			if(debug)
-				printf("SYS_CLOSE called\n");
-			
-			// validate memory
-			// invalid pointers must be rejected without harm to the kernel or other running processes
-			if(!IsValidVAddress(f->esp + 1))
-			{
-				if(debug)
-					printf( "Pointers not valid exiting thread :: kernal violation...\n" );
-				
-				// if any IsValidVAddress returns false
-				// halt code here as the thread will be terminated
-				exit(-1); // is invoked because why continue if we have bad memory here
-				return;
-			}
-			
-			// get the fd from the stack and bomvayage file!
-			close_via_fd(*((int*)f->esp + 1)); // 4
-			
-			break;
-			
+static uint32_t sys_wait(struct intr_frame *f UNUSED, uint32_t *args)
+{
+	return wait((tid_t) args[0]);
+}
+
+static uint32_t sys_create(struct intr_frame *f UNUSED, uint32_t *args)
+{
+	char *filename = (char *) args[0];
+	return filename != NULL && create(filename, (unsigned) args[1]);
+}
+
+static uint32_t sys_remove(struct intr_frame *f UNUSED, uint32_t *args)
+{
+	char *filename = (char *) args[0];
+	return filename != NULL && remove_file(filename);
+}
+
+static uint32_t sys_open(struct intr_frame *f UNUSED, uint32_t *args)
+{
+	const char *filename = (const char *) args[0];
+	return filename != NULL ? open(filename) : -1;
+}
+
+static uint32_t sys_filesize(struct intr_frame *f UNUSED, uint32_t *args)
+{
+	return get_filesize((int) args[0]);
+}
+
+static uint32_t sys_read(struct intr_frame *f UNUSED, uint32_t *args)
+{
+	return read((int) args[0], (void *) args[1], (unsigned) args[2]);
+}
+
+static uint32_t sys_write(struct intr_frame *f UNUSED, uint32_t *args)
+{
+	return write((int) args[0], (void *) args[1], (unsigned) args[2]);
+}
+
+static uint32_t sys_seek(struct intr_frame *f UNUSED, uint32_t *args)
+{
+	seek((int) args[0], (unsigned) args[1]);
+	return 0;
+}
+
+static uint32_t sys_tell(struct intr_frame *f UNUSED, uint32_t *args)
+{
+	return tell((int) args[0]);
+}
+
+static uint32_t sys_close(struct intr_frame *f UNUSED, uint32_t *args)
+{
+	close_via_fd((int) args[0]);
+	return 0;
+}
+
+// moves the program break and hands the old one back
+static uint32_t sys_sbrk(struct intr_frame *f UNUSED, uint32_t *args)
+{
+	return (uint32_t) process_sbrk((intptr_t) args[0]);
+}
+
+// the parent gets the child's id, the child gets 0 from process_fork
+static uint32_t sys_fork(struct intr_frame *f, uint32_t *args UNUSED)
+{
+	return process_fork(f);
+}
+
+// gives up the CPU; we carry on straight away if nothing else is ready
+static uint32_t sys_yield(struct intr_frame *f UNUSED, uint32_t *args UNUSED)
+{
+	thread_yield();
+	return 0;
+}
+
+// the null system call, used to time the way in and out
+static uint32_t sys_getpid(struct intr_frame *f UNUSED, uint32_t *args UNUSED)
+{
+	return thread_current()->tid;
+}
+
+// carries out one request from a system call ring the way the matching system call would,
+// and returns its result
+static int ring_do(const struct ring_request *rq)
+{
+	char *filename;
+	int result;
+
+	switch(rq->op)
+	{
+		case RING_NOP:
+			return 0;
+		case RING_READ:
+			check_buffer(rq->buf, rq->size, true);
+			return read(rq->fd, rq->buf, rq->size);
+		case RING_WRITE:
+			check_buffer(rq->buf, rq->size, false);
+			return write(rq->fd, rq->buf, rq->size);
+		case RING_OPEN:
+			filename = get_string(rq->buf);
+			if(filename == NULL)
+				return -1;
+			result = open(filename);
+			palloc_free_page(filename);
+			return result;
+		case RING_CLOSE:
+			close_via_fd(rq->fd);
+			return 0;
+		case RING_SEEK:
+			seek(rq->fd, rq->size);
+			return 0;
 		default:
-			
-			// invoke procedure
-			throw_not_implemented_message_and_terminate_thread(syscall_number);
-			break;
+			return -1;
+	}
+}
+
+// carries out up to COUNT requests from the system call ring at user address RING, stopping
+// early if the submission ring runs dry or the completion ring fills up, and returns how many
+// it did. see lib/syscall-ring.h. the ring stays in user memory and is only touched through
+// the copy routines, so a process that hands us a bad ring is killed like any other
+static uint32_t sys_ring_enter(struct intr_frame *f UNUSED, uint32_t *args)
+{
+	struct syscall_ring *ring = (struct syscall_ring *) args[0];
+	unsigned count = args[1];
+	// sq_head, sq_tail, cq_head, cq_tail, which start the ring
+	unsigned idx[4];
+	unsigned done;
+
+	if(!copy_from_user(idx, ring, sizeof idx))
+		exit(-1);
+
+	for(done = 0; done < count && idx[0] != idx[1] && idx[3] - idx[2] < RING_ENTRIES; done++)
+	{
+		struct ring_request rq;
+		struct ring_result res;
+
+		if(!copy_from_user(&rq, &ring->sq[idx[0] % RING_ENTRIES], sizeof rq))
+			exit(-1);
+		res.result = ring_do(&rq);
+		res.tag = rq.tag;
+		if(!copy_to_user(&ring->cq[idx[3] % RING_ENTRIES], &res, sizeof res))
+			exit(-1);
+		idx[0]++;
+		idx[3]++;
 	}
+
+	// hand the consumed requests and the new results over in one go
+	if(!copy_to_user(&ring->sq_head, &idx[0], sizeof idx[0])
+	   || !copy_to_user(&ring->cq_tail, &idx[3], sizeof idx[3]))
+		exit(-1);
+	return done;
+}
+
+static const struct syscall syscall_table[] =
+{
+	[SYS_HALT]     = { "halt",     sys_halt,     0, { 0 }, false },
+	[SYS_EXIT]     = { "exit",     sys_exit,     1, { ARG_WORD }, false },
+	[SYS_EXEC]     = { "exec",     sys_exec,     1, { ARG_STRING }, false },
+	[SYS_WAIT]     = { "wait",     sys_wait,     1, { ARG_WORD }, false },
+	[SYS_CREATE]   = { "create",   sys_create,   2, { ARG_STRING, ARG_WORD }, false },
+	[SYS_REMOVE]   = { "remove",   sys_remove,   1, { ARG_STRING }, false },
+	[SYS_OPEN]     = { "open",     sys_open,     1, { ARG_STRING }, false },
+	[SYS_FILESIZE] = { "filesize", sys_filesize, 1, { ARG_WORD }, false },
+	[SYS_READ]     = { "read",     sys_read,     3, { ARG_WORD, ARG_BUF_OUT, ARG_WORD }, true },
+	[SYS_WRITE]    = { "write",    sys_write,    3, { ARG_WORD, ARG_BUF_IN, ARG_WORD }, true },
+	[SYS_SEEK]     = { "seek",     sys_seek,     2, { ARG_WORD, ARG_WORD }, false },
+	[SYS_TELL]     = { "tell",     sys_tell,     1, { ARG_WORD }, false },
+	[SYS_CLOSE]    = { "close",    sys_close,    1, { ARG_WORD }, false },
+	[SYS_MMAP]     = { "mmap",     NULL,         0, { 0 }, false },
+	[SYS_MUNMAP]   = { "munmap",   NULL,         0, { 0 }, false },
+	[SYS_CHDIR]    = { "chdir",    NULL,         0, { 0 }, false },
+	[SYS_MKDIR]    = { "mkdir",    NULL,         0, { 0 }, false },
+	[SYS_READDIR]  = { "readdir",  NULL,         0, { 0 }, false },
+	[SYS_ISDIR]    = { "isdir",    NULL,         0, { 0 }, false },
+	[SYS_INUMBER]  = { "inumber",  NULL,         0, { 0 }, false },
+	[SYS_SBRK]     = { "sbrk",     sys_sbrk,     1, { ARG_WORD }, false },
+	[SYS_FORK]     = { "fork",     sys_fork,     0, { 0 }, false },
+	[SYS_YIELD]    = { "yield",    sys_yield,    0, { 0 }, false },
+	[SYS_GETPID]   = { "getpid",   sys_getpid,   0, { 0 }, true },
+	[SYS_RING_ENTER] = { "ring_enter", sys_ring_enter, 2, { ARG_WORD, ARG_WORD }, true },
+};
+
+#define SYSCALL_CNT (sizeof syscall_table / sizeof *syscall_table)
+
+// number of times each system call has been made, indexed by system call number
+static unsigned long long syscall_counts[SYSCALL_CNT];
+
+// prints how many times each system call has been made
+void syscall_print_stats (void)
+{
+	size_t i;
+
+	for(i = 0; i < SYSCALL_CNT; i++)
+		if(syscall_counts[i] > 0)
+			printf ("Syscall: %s called %llu times\n", syscall_table[i].name, syscall_counts[i]);
+}
+
+// called through interrupt 0x30, or straight from sysenter_entry
+void
+syscall_handler (struct intr_frame *f)
+{
+	const struct syscall *sc;
+	// arguments of the system call, fetched from registers or the user stack
+	uint32_t args[3];
+	int i;
+
+	// get the syscall number int or enum stored in the stack pointer, or in EAX for SYSENTER
+	int syscall_number;
+	if(f->vec_no == SYSENTER_VEC_NO)
+		syscall_number = (int) f->eax;
+	else if(!copy_from_user(&syscall_number, f->esp, sizeof syscall_number))
+		exit(-1);
+
+	if(syscall_number < 0 || (size_t) syscall_number >= SYSCALL_CNT
+	   || syscall_table[syscall_number].func == NULL)
+		throw_not_implemented_message_and_terminate_thread(syscall_number);
+
+	sc = &syscall_table[syscall_number];
+	syscall_counts[syscall_number]++;
+	if(debug && !sc->quiet)
+		printf( "%s called!\n", sc->name );
+
+	// fetch every argument and make sure the kernel can use it. invalid pointers must be
+	// rejected without harm to the kernel or other running processes
+	get_args(f, args, sc->argc);
+	for(i = 0; i < sc->argc; i++)
+		switch(sc->kinds[i])
+		{
+			case ARG_WORD:
+				break;
+			case ARG_STRING:
+				args[i] = (uint32_t) get_string((const char *) args[i]);
+				break;
+			case ARG_BUF_IN:
+			case ARG_BUF_OUT:
+				// the whole buffer must be usable by the process, whatever pages it spans
+				check_buffer((void *) args[i], (unsigned) args[i + 1], sc->kinds[i] == ARG_BUF_OUT);
+				break;
+		}
+
+	// set the EAX register :: System calls that return a value can do so
+	// by modifying the eax member of struct intr_frame
+	f->eax = sc->func(f, args);
+
+	for(i = 0; i < sc->argc; i++)
+		if(sc->kinds[i] == ARG_STRING && args[i] != 0)
+			palloc_free_page((void *) args[i]);
 }
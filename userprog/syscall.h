@@ -1,6 +1,16 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+
+struct intr_frame;
+struct thread;
+
 void syscall_init (void);
+void syscall_handler (struct intr_frame *);
+void syscall_print_stats (void);
+bool copy_file_descriptors (struct thread *from);
+bool syscall_fs_lock (void);
+void syscall_fs_unlock (bool taken);
 
 #endif /* userprog/syscall.h */
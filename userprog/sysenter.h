@@ -0,0 +1,11 @@
+#ifndef USERPROG_SYSENTER_H
+#define USERPROG_SYSENTER_H
+
+/* Value of struct intr_frame's vec_no member for a system call
+   that entered the kernel through SYSENTER, rather than through
+   "int $0x30".  Such a call passes its number in EAX and its
+   arguments in EBX, ESI and EDI, instead of on the user stack.
+   It is not a real interrupt vector. */
+#define SYSENTER_VEC_NO 0x130
+
+#endif /* userprog/sysenter.h */
@@ -96,6 +96,17 @@ tss_get (void)
   return tss;
 }
 
+/* Returns the address of the TSS's ring 0 stack pointer, which
+   always points to the end of the running process's kernel
+   stack.  The SYSENTER entry point loads its stack pointer from
+   there. */
+void **
+tss_get_esp0 (void)
+{
+  ASSERT (tss != NULL);
+  return &tss->esp0;
+}
+
 /* Sets the ring 0 stack pointer in the TSS to point to the end
    of the thread stack. */
 void
@@ -0,0 +1,117 @@
+#include "userprog/uaccess.h"
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+
+/* A fixup: if the instruction at INSN faults on a user address,
+   execution resumes at FIXUP. */
+struct uaccess_fixup
+  {
+    uintptr_t insn;
+    uintptr_t fixup;
+  };
+
+/* In usercopy.S. */
+extern const struct uaccess_fixup uaccess_fixups[];
+size_t uaccess_copy (void *dst, const void *src, size_t size);
+int uaccess_strncpy (char *dst, const char *src, size_t size);
+
+/* Returns true if the SIZE bytes starting at UADDR all lie below
+   PHYS_BASE. */
+static bool
+is_user_range (const void *uaddr, size_t size)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+  return start <= (uintptr_t) PHYS_BASE
+         && size <= (uintptr_t) PHYS_BASE - start;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address DST.
+   Returns true if successful, false if any of the source bytes
+   may not be read by the running process. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  return is_user_range (usrc, size) && uaccess_copy (dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address UDST.
+   Returns true if successful, false if any of the destination
+   bytes may not be written by the running process. */
+bool
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  return is_user_range (udst, size) && uaccess_copy (udst, src, size) == 0;
+}
+
+/* Copies the null-terminated string at user address USRC to
+   kernel buffer DST, which has room for SIZE bytes.  Returns the
+   length of the string, not counting the null terminator, if it
+   fits.  Returns SIZE, leaving DST unterminated, if the string is
+   too long.  Returns -1 if the string may not be read by the
+   running process. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+  size_t max;
+  int length;
+
+  if ((uintptr_t) usrc >= (uintptr_t) PHYS_BASE)
+    return -1;
+
+  /* A string that runs into kernel memory is as bad as one that
+     runs into an unmapped page. */
+  max = (uintptr_t) PHYS_BASE - (uintptr_t) usrc;
+  if (size <= max)
+    return uaccess_strncpy (dst, usrc, size);
+  length = uaccess_strncpy (dst, usrc, max);
+  return length == (int) max ? -1 : length;
+}
+
+/* Returns true if the running process may read the SIZE bytes at
+   user address UBUF, and write them too if WRITABLE, false
+   otherwise.  Faults in every page of the buffer along the way.
+   The kernel may then access the buffer directly, even if some of
+   its pages are later evicted, as long as it holds no lock that
+   resolving a fault may need: a fault can read from the swap
+   device, so a device transfer must never target the buffer
+   itself.  inode_read_at() and inode_write_at() copy user
+   buffers through a kernel page for that reason. */
+bool
+check_user_buffer (void *ubuf, size_t size, bool writable)
+{
+  uint8_t *start = ubuf;
+  uint8_t *end = start + size;
+  uint8_t *p;
+
+  if (!is_user_range (ubuf, size))
+    return false;
+
+  for (p = start; p < end; p = pg_round_down (p) + PGSIZE)
+    {
+      uint8_t byte;
+
+      if (uaccess_copy (&byte, p, 1) != 0
+          || (writable && uaccess_copy (p, &byte, 1) != 0))
+        return false;
+    }
+  return true;
+}
+
+/* Called by the page fault handler for a fault by the kernel on a
+   user address that could not be resolved.  If the fault happened
+   in one of the routines above, makes F resume at the matching
+   fixup and returns true.  Otherwise, returns false. */
+bool
+uaccess_fixup (struct intr_frame *f)
+{
+  const struct uaccess_fixup *fx;
+
+  for (fx = uaccess_fixups; fx->insn != 0; fx++)
+    if (fx->insn == (uintptr_t) f->eip)
+      {
+        f->eip = (void (*) (void)) fx->fixup;
+        return true;
+      }
+  return false;
+}
@@ -0,0 +1,25 @@
+#ifndef USERPROG_UACCESS_H
+#define USERPROG_UACCESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct intr_frame;
+
+/* Access to user memory from the kernel.
+
+   These routines simply touch user memory, as the process itself
+   would, so the common case costs no more than a memcpy().  An
+   access that faults on a page the process may not touch is not a
+   kernel bug: the page fault handler finds the faulting
+   instruction in a table of fixups and resumes at code that makes
+   the routine fail.  Addresses at or above PHYS_BASE are rejected
+   up front. */
+
+bool copy_from_user (void *dst, const void *usrc, size_t size);
+bool copy_to_user (void *udst, const void *src, size_t size);
+int strncpy_from_user (char *dst, const char *usrc, size_t size);
+bool check_user_buffer (void *ubuf, size_t size, bool writable);
+bool uaccess_fixup (struct intr_frame *);
+
+#endif /* userprog/uaccess.h */
@@ -0,0 +1,103 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "threads/synch.h"
+
+/* The swap partition, or a null pointer if there is none. */
+static struct block *swap_block;
+
+/* Sectors of SWAP_BLOCK in use, one bit per sector. */
+static struct bitmap *used_map;
+
+/* Protects USED_MAP and the counters. */
+static struct lock swap_lock;
+
+/* Sectors transferred, and the number of transfers. */
+static unsigned long long write_cnt, read_cnt;
+static unsigned long long sectors_written, sectors_read;
+
+/* Initializes swap space on the partition that has the swap
+   role, if any. */
+void
+swap_init (void)
+{
+  lock_init (&swap_lock);
+  swap_block = block_get_role (BLOCK_SWAP);
+  if (swap_block == NULL)
+    return;
+
+  used_map = bitmap_create (block_size (swap_block));
+  if (used_map == NULL)
+    PANIC ("bitmap creation failed--swap partition is too large");
+}
+
+/* Writes the SECTOR_CNT sectors of data in BUF to consecutive
+   free sectors of the swap partition, in a single request to the
+   device, and returns the first of them.  Returns SWAP_ERROR if
+   there is no swap partition or no run of SECTOR_CNT free
+   sectors in it. */
+block_sector_t
+swap_write (const void *buf, size_t sector_cnt)
+{
+  size_t sector;
+
+  ASSERT (sector_cnt > 0);
+  if (swap_block == NULL)
+    return SWAP_ERROR;
+
+  lock_acquire (&swap_lock);
+  sector = bitmap_scan_and_flip (used_map, 0, sector_cnt, false);
+  if (sector != BITMAP_ERROR)
+    {
+      write_cnt++;
+      sectors_written += sector_cnt;
+    }
+  lock_release (&swap_lock);
+
+  if (sector == BITMAP_ERROR)
+    return SWAP_ERROR;
+  block_write_multiple (swap_block, sector, sector_cnt, buf);
+  return sector;
+}
+
+/* Reads SECTOR_CNT sectors starting at SECTOR, written earlier
+   by swap_write(), into BUF. */
+void
+swap_read (block_sector_t sector, void *buf, size_t sector_cnt)
+{
+  ASSERT (swap_block != NULL);
+  ASSERT (bitmap_all (used_map, sector, sector_cnt));
+
+  block_read_multiple (swap_block, sector, sector_cnt, buf);
+
+  lock_acquire (&swap_lock);
+  read_cnt++;
+  sectors_read += sector_cnt;
+  lock_release (&swap_lock);
+}
+
+/* Frees the SECTOR_CNT sectors starting at SECTOR, written
+   earlier by swap_write(). */
+void
+swap_release (block_sector_t sector, size_t sector_cnt)
+{
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_all (used_map, sector, sector_cnt));
+  bitmap_set_multiple (used_map, sector, sector_cnt, false);
+  lock_release (&swap_lock);
+}
+
+/* Prints swap partition statistics. */
+void
+swap_print_stats (void)
+{
+  if (swap_block == NULL)
+    return;
+  printf ("Swap: %llu writes of %llu sectors, %llu reads of %llu sectors, "
+          "%zu of %"PRDSNu" sectors in use\n",
+          write_cnt, sectors_written, read_cnt, sectors_read,
+          bitmap_count (used_map, 0, bitmap_size (used_map), true),
+          block_size (swap_block));
+}
@@ -0,0 +1,22 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+
+/* Sector allocation on the swap partition.
+
+   Evicted pages are compressed before they reach the disk, so
+   space is handed out in runs of sectors, not in whole pages. */
+
+/* Returned by swap_write() on failure. */
+#define SWAP_ERROR ((block_sector_t) -1)
+
+void swap_init (void);
+block_sector_t swap_write (const void *, size_t sector_cnt);
+void swap_read (block_sector_t, void *, size_t sector_cnt);
+void swap_release (block_sector_t, size_t sector_cnt);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */
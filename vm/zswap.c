@@ -0,0 +1,503 @@
+#include "vm/zswap.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <lz.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/frame.h"
+#include "userprog/pagedir.h"
+#include "vm/swap.h"
+
+/* An evicted page.  Its contents are in exactly one place: in
+   kernel memory (DATA), on the swap partition (SECTOR), or, if
+   neither could take it, still in its original frame (FRAME). */
+struct zpage
+  {
+    struct list_elem lru_elem;  /* Element in lru, if DATA. */
+    unsigned ref_cnt;           /* Number of zmaps. */
+    size_t size;                /* Bytes of contents. */
+    bool compressed;            /* Compressed, or stored as is? */
+    uint8_t *data;              /* Contents in kernel memory. */
+    block_sector_t sector;      /* First sector on swap partition. */
+    void *frame;                /* Frame it was evicted from. */
+  };
+
+/* An evicted page as seen from one page directory.  After fork,
+   several of these share one zpage. */
+struct zmap
+  {
+    struct hash_elem elem;      /* Element in zmaps. */
+    uint32_t *pd;               /* Page directory. */
+    void *upage;                /* User virtual page. */
+    struct zpage *page;         /* The page. */
+  };
+
+size_t zswap_budget_kb = 1024;
+
+/* All zmaps, keyed by (pd, upage). */
+static struct hash zmaps;
+
+/* zpages whose contents are in kernel memory, least recently
+   evicted first. */
+static struct list lru;
+
+/* Kernel memory taken by contents on LRU. */
+static size_t ram_bytes;
+
+/* Scratch space for compression, and a page-sized buffer for
+   compressed contents on their way to or from the disk. */
+static uint8_t lz_work[LZ_WORK_SIZE];
+static uint8_t buffer[PGSIZE];
+
+/* Where the evictor's clock hand is: the thread whose pages it
+   looked at last, and the page after the one it took. */
+static tid_t hand_tid;
+static const void *hand_upage;
+
+/* Statistics. */
+static unsigned long long evict_cnt, evict_fail_cnt;
+static unsigned long long raw_cnt, writeback_cnt;
+static unsigned long long bytes_in, bytes_out;
+static unsigned long long ram_fault_cnt, disk_fault_cnt;
+static unsigned long long scan_cnt, clear_cnt;
+
+/* Protects everything above, and serializes eviction. */
+static struct lock zswap_lock;
+
+static hash_hash_func zmap_hash;
+static hash_less_func zmap_less;
+
+/* Initializes the compressed swap cache and the swap partition
+   behind it. */
+void
+zswap_init (void)
+{
+  swap_init ();
+  hash_init (&zmaps, zmap_hash, zmap_less, NULL);
+  list_init (&lru);
+  lock_init (&zswap_lock);
+}
+
+/* Returns the number of sectors needed for SIZE bytes. */
+static size_t
+sector_cnt (size_t size)
+{
+  return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
+}
+
+/* Returns the zmap for UPAGE in PD, or a null pointer if UPAGE is
+   not swapped out. */
+static struct zmap *
+zmap_lookup (uint32_t *pd, const void *upage)
+{
+  struct zmap key;
+  struct hash_elem *e;
+
+  key.pd = pd;
+  key.upage = (void *) upage;
+  e = hash_find (&zmaps, &key.elem);
+  return e != NULL ? hash_entry (e, struct zmap, elem) : NULL;
+}
+
+/* Moves the contents of the page evicted longest ago that is
+   still in kernel memory to the swap partition.  Returns false if
+   there is no such page or no room on the swap partition. */
+static bool
+write_back_oldest (void)
+{
+  struct zpage *page;
+  size_t cnt;
+
+  if (list_empty (&lru))
+    return false;
+  page = list_entry (list_front (&lru), struct zpage, lru_elem);
+  cnt = sector_cnt (page->size);
+
+  page->sector = swap_write (page->data, cnt);
+  if (page->sector == SWAP_ERROR)
+    return false;
+
+  list_remove (&page->lru_elem);
+  free (page->data);
+  page->data = NULL;
+  ram_bytes -= cnt * BLOCK_SECTOR_SIZE;
+  writeback_cnt++;
+  return true;
+}
+
+/* Stores the contents of KPAGE, just evicted, in PAGE.  Returns
+   true if successful, false if there was nowhere to put them, in
+   which case PAGE keeps KPAGE itself and the caller's reference
+   to it. */
+static bool
+store (struct zpage *page, void *kpage)
+{
+  size_t size, alloc;
+
+  page->data = NULL;
+  page->frame = NULL;
+  page->sector = SWAP_ERROR;
+
+  /* Pages that do not compress to at least a sector less than
+     they started with go straight to disk as they are. */
+  size = lz_compress (kpage, PGSIZE, buffer, PGSIZE - BLOCK_SECTOR_SIZE,
+                      lz_work);
+  if (size == 0)
+    {
+      page->compressed = false;
+      page->size = PGSIZE;
+      page->sector = swap_write (kpage, sector_cnt (PGSIZE));
+      raw_cnt++;
+    }
+  else
+    {
+      page->compressed = true;
+      page->size = size;
+      bytes_in += PGSIZE;
+      bytes_out += size;
+
+      /* Keep it in memory, making room if need be, else write it
+         to disk directly. */
+      alloc = sector_cnt (size) * BLOCK_SECTOR_SIZE;
+      while (ram_bytes + alloc > zswap_budget_kb * 1024
+             && write_back_oldest ())
+        continue;
+      if (ram_bytes + alloc <= zswap_budget_kb * 1024)
+        page->data = malloc (alloc);
+      if (page->data != NULL)
+        {
+          memcpy (page->data, buffer, size);
+          list_push_back (&lru, &page->lru_elem);
+          ram_bytes += alloc;
+        }
+      else
+        page->sector = swap_write (buffer, sector_cnt (size));
+    }
+
+  if (page->data == NULL && page->sector == SWAP_ERROR)
+    {
+      page->frame = kpage;
+      return false;
+    }
+  return true;
+}
+
+/* Copies the contents of PAGE into KPAGE. */
+static void
+load (struct zpage *page, void *kpage)
+{
+  size_t size = page->size;
+
+  if (page->frame != NULL)
+    memcpy (kpage, page->frame, PGSIZE);
+  else if (page->data != NULL)
+    {
+      size = lz_decompress (page->data, page->size, kpage, PGSIZE);
+      ram_fault_cnt++;
+    }
+  else if (!page->compressed)
+    {
+      swap_read (page->sector, kpage, sector_cnt (PGSIZE));
+      disk_fault_cnt++;
+    }
+  else
+    {
+      swap_read (page->sector, buffer, sector_cnt (page->size));
+      size = lz_decompress (buffer, page->size, kpage, PGSIZE);
+      disk_fault_cnt++;
+    }
+  ASSERT (page->frame != NULL || size == PGSIZE);
+}
+
+/* Drops a reference to PAGE, freeing it and wherever its contents
+   are kept when the last one goes away. */
+static void
+release (struct zpage *page)
+{
+  ASSERT (page->ref_cnt > 0);
+  if (--page->ref_cnt > 0)
+    return;
+
+  if (page->data != NULL)
+    {
+      list_remove (&page->lru_elem);
+      ram_bytes -= sector_cnt (page->size) * BLOCK_SECTOR_SIZE;
+      free (page->data);
+    }
+  else if (page->sector != SWAP_ERROR)
+    swap_release (page->sector, sector_cnt (page->size));
+  if (page->frame != NULL)
+    frame_put_page (page->frame);
+  free (page);
+}
+
+/* pagedir_scan() callback for find_victim().  Gives pages that
+   have been accessed since the last pass a second chance, and
+   accepts the first page that has not been whose frame no one
+   else maps.  The TLB entries of the pages whose accessed bits
+   it clears are invalidated in one go, through BATCH, once the
+   scan of PD is over. */
+static bool
+consider_page (uint32_t *pd, void *upage, void *kpage, void *batch)
+{
+  scan_cnt++;
+  if (!frame_evictable (kpage))
+    return false;
+  if (pagedir_test_and_clear_accessed (pd, upage, batch))
+    {
+      clear_cnt++;
+      return false;
+    }
+  return true;
+}
+
+/* State of a search for a page to evict. */
+struct victim_search
+  {
+    tid_t from_tid;             /* Skip threads before this one. */
+    const void *from_upage;     /* Start in FROM_TID's pages here. */
+    struct thread *t;           /* Owner of the victim, if found. */
+    void *upage;                /* The victim. */
+  };
+
+/* thread_foreach() callback for find_victim(). */
+static void
+search_thread (struct thread *t, void *vs_)
+{
+  struct victim_search *vs = vs_;
+  struct pagedir_batch batch;
+  const void *start = NULL;
+
+  if (vs->t != NULL || t->pagedir == NULL || t->pagedir_busy
+      || t->tid < vs->from_tid)
+    return;
+  if (t->tid == vs->from_tid)
+    start = vs->from_upage;
+
+  pagedir_batch_init (&batch, t->pagedir);
+  vs->upage = pagedir_scan (t->pagedir, start, consider_page, &batch);
+  pagedir_batch_flush (&batch);
+  if (vs->upage != NULL)
+    vs->t = t;
+}
+
+/* Chooses a page to evict by sweeping a clock hand over the pages
+   of every process in turn, skipping processes that are in the
+   middle of changing their page tables.  Returns the thread whose
+   page it chose and stores the page into *UPAGE, or returns a
+   null pointer if there is nothing to evict.
+   Must be called with interrupts off, so that the chosen page
+   stays as it is until it has been unmapped. */
+static struct thread *
+find_victim (void **upage)
+{
+  struct victim_search vs;
+  int sweep;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  vs.from_tid = hand_tid;
+  vs.from_upage = hand_upage;
+  vs.t = NULL;
+
+  /* The first sweep may only clear accessed bits; the next ones
+     find what it cleared. */
+  for (sweep = 0; sweep < 3 && vs.t == NULL; sweep++)
+    {
+      thread_foreach (search_thread, &vs);
+      vs.from_tid = TID_ERROR;
+    }
+  if (vs.t == NULL)
+    return NULL;
+
+  hand_tid = vs.t->tid;
+  hand_upage = (uint8_t *) vs.upage + PGSIZE;
+  *upage = vs.upage;
+  return vs.t;
+}
+
+/* Evicts a user page to make its frame free.  Returns true if
+   successful, false if no page could be evicted or there was
+   nowhere to put it. */
+bool
+zswap_evict (void)
+{
+  struct zmap *map = malloc (sizeof *map);
+  struct zpage *page = malloc (sizeof *page);
+  enum intr_level old_level;
+  struct thread *t;
+  void *kpage = NULL;
+  bool success;
+
+  if (map == NULL || page == NULL)
+    {
+      free (map);
+      free (page);
+      return false;
+    }
+
+  lock_acquire (&zswap_lock);
+
+  old_level = intr_disable ();
+  t = find_victim (&map->upage);
+  if (t != NULL)
+    {
+      map->pd = t->pagedir;
+      kpage = pagedir_swap_out (map->pd, map->upage);
+    }
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    {
+      lock_release (&zswap_lock);
+      free (map);
+      free (page);
+      return false;
+    }
+
+  map->page = page;
+  page->ref_cnt = 1;
+  hash_insert (&zmaps, &map->elem);
+  success = store (page, kpage);
+  if (success)
+    evict_cnt++;
+  else
+    evict_fail_cnt++;
+  lock_release (&zswap_lock);
+
+  if (success)
+    frame_put_page (kpage);
+  return success;
+}
+
+/* If user virtual page UPAGE in page directory PD, which must be
+   the running process's, is swapped out, brings it back in and
+   returns true.  Otherwise, or if memory allocation fails,
+   returns false. */
+bool
+zswap_fault (uint32_t *pd, void *upage)
+{
+  struct zmap *map;
+  struct zpage *page;
+  void *kpage;
+
+  upage = pg_round_down (upage);
+  if (!pagedir_is_swapped (pd, upage))
+    return false;
+
+  /* Get the frame first: doing so may evict, which needs the
+     lock. */
+  kpage = frame_get_page (0);
+  if (kpage == NULL)
+    return false;
+
+  lock_acquire (&zswap_lock);
+  map = zmap_lookup (pd, upage);
+  ASSERT (map != NULL);
+  page = map->page;
+
+  if (page->frame != NULL && page->ref_cnt == 1)
+    {
+      /* Never left its frame: take it back. */
+      frame_put_page (kpage);
+      kpage = page->frame;
+      page->frame = NULL;
+    }
+  else
+    load (page, kpage);
+
+  hash_delete (&zmaps, &map->elem);
+  release (page);
+  pagedir_swap_in (pd, upage, kpage);
+  lock_release (&zswap_lock);
+
+  free (map);
+  return true;
+}
+
+/* Makes swapped-out user virtual page UPAGE in PD swapped out in
+   CHILD too, sharing the swapped-out copy, for fork.  Returns
+   false if memory allocation fails. */
+bool
+zswap_fork (uint32_t *pd, uint32_t *child, void *upage)
+{
+  struct zmap *map = malloc (sizeof *map);
+  struct zmap *parent;
+
+  if (map == NULL)
+    return false;
+
+  lock_acquire (&zswap_lock);
+  parent = zmap_lookup (pd, upage);
+  ASSERT (parent != NULL);
+  map->pd = child;
+  map->upage = upage;
+  map->page = parent->page;
+  map->page->ref_cnt++;
+  hash_insert (&zmaps, &map->elem);
+  lock_release (&zswap_lock);
+  return true;
+}
+
+/* Forgets swapped-out user virtual page UPAGE in PD, because PD
+   no longer maps it. */
+void
+zswap_discard (uint32_t *pd, void *upage)
+{
+  struct zmap *map;
+
+  lock_acquire (&zswap_lock);
+  map = zmap_lookup (pd, upage);
+  if (map != NULL)
+    {
+      hash_delete (&zmaps, &map->elem);
+      release (map->page);
+    }
+  lock_release (&zswap_lock);
+  free (map);
+}
+
+/* Prints eviction statistics. */
+void
+zswap_print_stats (void)
+{
+  printf ("Zswap: %llu evictions (%llu failed), %zu of %zu kB in use, "
+          "%llu pages written back\n",
+          evict_cnt, evict_fail_cnt, ram_bytes / 1024, zswap_budget_kb,
+          writeback_cnt);
+  printf ("Zswap: %llu kB compressed to %llu kB, %llu pages incompressible, "
+          "%llu faults from memory, %llu from disk\n",
+          bytes_in / 1024, bytes_out / 1024, raw_cnt,
+          ram_fault_cnt, disk_fault_cnt);
+  printf ("Zswap: %llu pages scanned, %llu accessed bits cleared\n",
+          scan_cnt, clear_cnt);
+  swap_print_stats ();
+}
+
+/* Returns a hash value for zmap E. */
+static unsigned
+zmap_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct zmap *map = hash_entry (e, struct zmap, elem);
+  return hash_bytes (&map->pd, sizeof map->pd) ^ hash_int ((int) map->upage);
+}
+
+/* Returns true if zmap A precedes zmap B. */
+static bool
+zmap_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct zmap *a = hash_entry (a_, struct zmap, elem);
+  const struct zmap *b = hash_entry (b_, struct zmap, elem);
+
+  if (a->pd != b->pd)
+    return a->pd < b->pd;
+  return a->upage < b->upage;
+}
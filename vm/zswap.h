@@ -0,0 +1,27 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* User page eviction through a compressed in-memory swap cache.
+
+   When the user pool runs dry, the evictor picks a private,
+   recently unused user page, compresses it and keeps it in kernel
+   memory, up to a budget.  Past the budget, the pages evicted
+   longest ago move on to the swap partition, still compressed, so
+   that each takes a few sectors rather than eight. */
+
+/* Kernel memory, in kilobytes, that compressed pages may take up
+   before the oldest are written to the swap partition. */
+extern size_t zswap_budget_kb;
+
+void zswap_init (void);
+bool zswap_evict (void);
+bool zswap_fault (uint32_t *pd, void *upage);
+bool zswap_fork (uint32_t *pd, uint32_t *child, void *upage);
+void zswap_discard (uint32_t *pd, void *upage);
+void zswap_print_stats (void);
+
+#endif /* vm/zswap.h */